@@ -0,0 +1,84 @@
+// Compares the memory held by the results of a large recursive glob as a vector of `fs::path`
+// and as `glob::compact_paths`, over an in-memory tree so the filesystem does not get in the way.
+// Counts the heap allocations made while globbing and those still live in the result.
+//
+// Usage: compact_results [directories] [files per directory]
+
+#include <glob/glob.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> live_bytes{0};
+
+using clock_type = std::chrono::steady_clock;
+
+void report(const std::string &name, std::size_t count, std::size_t retained, std::size_t calls,
+            clock_type::duration elapsed) {
+  std::cout << std::left << std::setw(24) << name << std::right << std::setw(10) << count << " matches"
+            << std::setw(10) << retained / 1024 << " KiB held" << std::setw(8) << std::fixed
+            << std::setprecision(1) << double(retained) / count << " B/match" << std::setw(12) << calls
+            << " allocations" << std::setw(10)
+            << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms\n";
+}
+
+// Runs `run`, then reports what the result it returns holds
+template <typename Run> void measure(const std::string &name, Run &&run) {
+  const auto calls = allocations.load();
+  const auto before = live_bytes.load();
+  const auto start = clock_type::now();
+  const auto result = run();
+  const auto elapsed = clock_type::now() - start;
+  report(name, result.size(), live_bytes.load() - before, allocations.load() - calls, elapsed);
+}
+
+} // namespace
+
+// Every allocation is prefixed with its size so frees can be subtracted from the live total
+void *operator new(std::size_t size) {
+  auto *block = static_cast<std::size_t *>(std::malloc(size + sizeof(std::max_align_t)));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *block = size;
+  ++allocations;
+  live_bytes += size;
+  return reinterpret_cast<char *>(block) + sizeof(std::max_align_t);
+}
+
+void operator delete(void *p) noexcept {
+  if (p) {
+    auto *block = reinterpret_cast<std::size_t *>(static_cast<char *>(p) - sizeof(std::max_align_t));
+    live_bytes -= *block;
+    std::free(block);
+  }
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+
+int main(int argc, char **argv) {
+  const int directories = argc > 1 ? std::stoi(argv[1]) : 2000;
+  const int files = argc > 2 ? std::stoi(argv[2]) : 100;
+
+  glob::memory_backend tree;
+  for (int d = 0; d < directories; ++d) {
+    const auto dirname = "srv/data/project_" + std::to_string(d % 20) + "/shard_" + std::to_string(d) + "/";
+    for (int f = 0; f < files; ++f) {
+      tree.add_file(dirname + "part-" + std::to_string(f) + ".parquet");
+    }
+  }
+  glob::options opts;
+  opts.backend = &tree;
+
+  measure("rglob", [&] { return glob::rglob("srv/**/*.parquet", opts); });
+  measure("rglob_compact", [&] { return glob::rglob_compact("srv/**/*.parquet", opts); });
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Measures how much of the per-call filesystem latency `options::io_concurrency` hides, using a
+// backend that adds an artificial delay to every listing and probe of an in-memory tree (a
+// stand-in for an NFS or FUSE mount).
+//
+// Usage: io_latency [delay in microseconds] [fan-out] [depth]
+
+#include <glob/glob.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+
+class delay_backend : public glob::backend {
+public:
+  delay_backend(const glob::backend &inner, std::chrono::microseconds delay)
+      : inner_(inner), delay_(delay) {}
+
+  bool list(const glob::fs::path &dirname, entry_list &entries) const override {
+    std::this_thread::sleep_for(delay_);
+    return inner_.list(dirname, entries);
+  }
+
+  glob::fs::file_type type(const glob::fs::path &path) const override {
+    std::this_thread::sleep_for(delay_);
+    return inner_.type(path);
+  }
+
+private:
+  const glob::backend &inner_;
+  std::chrono::microseconds delay_;
+};
+
+void add_tree(glob::memory_backend &tree, const std::string &dir, int fan_out, int depth) {
+  tree.add_file(dir + "/Makefile");
+  tree.add_file(dir + "/data.bin");
+  if (depth == 0) {
+    return;
+  }
+  for (int i = 0; i < fan_out; ++i) {
+    add_tree(tree, dir + "/d" + std::to_string(i), fan_out, depth - 1);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const auto delay = std::chrono::microseconds(argc > 1 ? std::stoi(argv[1]) : 500);
+  const int fan_out = argc > 2 ? std::stoi(argv[2]) : 6;
+  const int depth = argc > 3 ? std::stoi(argv[3]) : 3;
+
+  glob::memory_backend tree;
+  add_tree(tree, "root", fan_out, depth);
+  const delay_backend slow(tree, delay);
+
+  std::cout << "delay " << delay.count() << " us per call, fan-out " << fan_out << ", depth "
+            << depth << "\n";
+  for (auto pattern : {"root/**/Makefile", "root/*/*/*/*.bin"}) {
+    for (unsigned concurrency : {1u, 4u, 16u, 64u}) {
+      glob::options opts;
+      opts.backend = &slow;
+      opts.io_concurrency = concurrency;
+
+      const auto start = std::chrono::steady_clock::now();
+      const auto matches = glob::rglob(pattern, opts);
+      const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+      std::cout << pattern << " io_concurrency " << concurrency << ": " << elapsed.count() << " ms ("
+                << matches.size() << " matches)\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Measures how fast each matching engine decides whether single names match shell patterns,
+// without any filesystem access: the native matcher (alone, case-insensitive, and as a
+// multi-pattern `pattern_set`) and the C library's fnmatch(3). The regex translation is only
+// used by case-sensitive globbing, so it is timed end to end against the native matcher by
+// globbing an in-memory directory of the same names. Then times pathological patterns such as
+// "*a*a*a*a*b" on long names.
+//
+// Usage: matcher [patterns] [names]
+
+#include <glob/glob.h>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fnmatch.h>
+#endif
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// Patterns shaped like the ones people write: extensions, prefixes, infixes, sets, '?'
+std::vector<std::string> make_patterns(std::size_t count, std::mt19937 &rng) {
+  static const char *const WORDS[] = {"main", "test", "util", "glob", "string", "config", "data"};
+  static const char *const EXTENSIONS[] = {"cpp", "h", "txt", "md", "json", "o"};
+  std::vector<std::string> patterns;
+  while (patterns.size() < count) {
+    const std::string word = WORDS[rng() % std::size(WORDS)];
+    const std::string extension = EXTENSIONS[rng() % std::size(EXTENSIONS)];
+    switch (rng() % 6) {
+    case 0: patterns.push_back("*." + extension); break;
+    case 1: patterns.push_back(word + "*"); break;
+    case 2: patterns.push_back("*" + word + "*." + extension); break;
+    case 3: patterns.push_back("[a-m]*." + extension); break;
+    case 4: patterns.push_back(word + "_???." + extension); break;
+    default: patterns.push_back("*[!0-9]." + extension); break;
+    }
+  }
+  return patterns;
+}
+
+std::vector<std::string> make_names(std::size_t count, std::mt19937 &rng) {
+  static const char *const WORDS[] = {"main", "test", "util", "glob", "string", "config", "data", "x"};
+  static const char *const EXTENSIONS[] = {"cpp", "h", "txt", "md", "json", "o", "hpp"};
+  std::vector<std::string> names;
+  while (names.size() < count) {
+    std::string name = WORDS[rng() % std::size(WORDS)];
+    for (auto n = rng() % 3; n > 0; --n) {
+      name += '_';
+      name += WORDS[rng() % std::size(WORDS)];
+    }
+    if (rng() % 2) {
+      name += std::to_string(rng() % 1000);
+    }
+    names.push_back(name + "." + EXTENSIONS[rng() % std::size(EXTENSIONS)]);
+  }
+  return names;
+}
+
+void report(const std::string &engine, std::size_t pairs, clock_type::duration elapsed, std::size_t matches) {
+  const auto seconds = std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(28) << engine << std::right << std::setw(10) << std::fixed
+            << std::setprecision(2) << pairs / seconds / 1e6 << " M matches/s  (" << matches << " hits)\n";
+}
+
+// Runs `match` over every (pattern, name) pair and prints the rate
+void measure(const std::string &engine, const std::vector<std::string> &names, std::size_t patterns,
+             const std::function<bool(std::size_t, const std::string &)> &match) {
+  std::size_t matches = 0;
+  const auto start = clock_type::now();
+  for (std::size_t p = 0; p < patterns; ++p) {
+    for (auto &name : names) {
+      matches += match(p, name);
+    }
+  }
+  report(engine, patterns * names.size(), clock_type::now() - start, matches);
+}
+
+// Globs every pattern in the directory "names" of `opts.backend`, holding `names` entries, and
+// prints the rate in (pattern, name) pairs
+void measure_glob(const std::string &engine, const std::vector<std::string> &patterns, std::size_t names,
+                  const glob::options &opts) {
+  std::size_t matches = 0;
+  const auto start = clock_type::now();
+  for (auto &pattern : patterns) {
+    matches += glob::glob("names/" + pattern, opts).size();
+  }
+  report(engine, patterns.size() * names, clock_type::now() - start, matches);
+}
+
+// Prints the average time of `match`, repeating it for up to a fifth of a second
+void measure_once(const std::string &engine, const std::function<bool()> &match) {
+  int repetitions = 0;
+  const auto start = clock_type::now();
+  do {
+    match();
+    ++repetitions;
+  } while (clock_type::now() - start < std::chrono::milliseconds(200) && repetitions < 1000);
+  const auto micros = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / repetitions;
+  std::cout << "  " << std::left << std::setw(26) << engine << std::right << std::setw(12) << std::fixed
+            << std::setprecision(2) << micros << " us\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t pattern_count = argc > 1 ? std::stoul(argv[1]) : 200;
+  const std::size_t name_count = argc > 2 ? std::stoul(argv[2]) : 5000;
+
+  std::mt19937 rng(2024);
+  const auto patterns = make_patterns(pattern_count, rng);
+  const auto names = make_names(name_count, rng);
+  std::cout << patterns.size() << " patterns x " << names.size() << " names\n";
+
+  std::vector<glob::pattern_set> natives;
+  std::vector<glob::pattern_set> folded;
+  glob::options case_insensitive;
+  case_insensitive.case_insensitive = true;
+  for (auto &pattern : patterns) {
+    natives.emplace_back(std::vector<std::string>{pattern}, false);
+    folded.emplace_back(std::vector<std::string>{pattern}, false, case_insensitive);
+  }
+  const glob::pattern_set all(patterns, false);
+
+  measure("native", names, patterns.size(),
+          [&](std::size_t p, const std::string &name) { return natives[p].match(name); });
+  measure("native, case-insensitive", names, patterns.size(),
+          [&](std::size_t p, const std::string &name) { return folded[p].match(name); });
+#ifndef _WIN32
+  measure("fnmatch(3)", names, patterns.size(), [&](std::size_t p, const std::string &name) {
+    return ::fnmatch(patterns[p].c_str(), name.c_str(), FNM_NOESCAPE) == 0;
+  });
+#endif
+  // One call per name checks it against every pattern at once
+  measure("pattern_set, all patterns", names, 1, [&](std::size_t, const std::string &name) {
+    return all.match(name);
+  });
+  std::cout << "  (pattern_set rate above is names/s; multiply by " << patterns.size() << " for pairs/s)\n";
+
+  // Case-sensitive globbing matches with the regex translation, case-insensitive globbing with
+  // the native matcher; both rates include listing the directory and building the paths
+  glob::memory_backend directory;
+  for (auto &name : names) {
+    directory.add_file("names/" + name);
+  }
+  glob::options regex_glob;
+  regex_glob.backend = &directory;
+  auto native_glob = regex_glob;
+  native_glob.case_insensitive = true;
+  measure_glob("glob, regex", patterns, names.size(), regex_glob);
+  measure_glob("glob, native", patterns, names.size(), native_glob);
+
+  const std::string pathological = "*a*a*a*a*b";
+  const glob::pattern_set pathological_native({pathological}, false);
+  for (std::size_t length : {16, 32, 256, 4096}) {
+    const std::string name(length, 'a');
+    std::cout << pathological << " against " << length << " x 'a':\n";
+    glob::memory_backend single;
+    single.add_file("names/" + name);
+    regex_glob.backend = &single;
+    // std::regex backtracks exponentially here; 64 characters already take most of a second
+    if (length <= 32) {
+      measure_once("glob, regex", [&] { return glob::glob("names/" + pathological, regex_glob).empty(); });
+    } else {
+      std::cout << "  " << std::left << std::setw(26) << "glob, regex" << std::right << std::setw(12) << "skipped\n";
+    }
+    measure_once("native", [&] { return pathological_native.match(name); });
+#ifndef _WIN32
+    measure_once("fnmatch(3)", [&] { return ::fnmatch(pathological.c_str(), name.c_str(), 0) == 0; });
+#endif
+  }
+  return 0;
+}
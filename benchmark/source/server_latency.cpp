@@ -0,0 +1,174 @@
+// Compares per-query latency of the standalone `glob` binary cold-started for every query against
+// a `glob --serve` daemon, reached both through `glob --connect` and over a persistent socket.
+//
+// Usage: server_latency <path/to/glob> <pattern> [iterations] [-r]
+
+#include <glob/glob.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+pid_t spawn(const std::vector<std::string> &args) {
+  std::vector<char *> argv;
+  for (auto &arg : args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+  pid_t pid = -1;
+  if (posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0) {
+    pid = -1;
+  }
+  posix_spawn_file_actions_destroy(&actions);
+  return pid;
+}
+
+bool run(const std::vector<std::string> &args) {
+  auto pid = spawn(args);
+  int status = 0;
+  return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+         WEXITSTATUS(status) == 0;
+}
+
+int connect_to(const std::string &socket_path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+// Sends one batch and reads until the terminating empty record
+bool roundtrip(int fd, const std::string &request) {
+  if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+    return false;
+  }
+  // The batch ends with an empty record; the start of the response counts as a record start
+  char previous = '\0';
+  char chunk[4096];
+  while (true) {
+    auto n = ::read(fd, chunk, sizeof(chunk));
+    if (n <= 0) {
+      return false;
+    }
+    for (ssize_t i = 0; i < n; ++i) {
+      if (chunk[i] == '\0' && previous == '\0') {
+        return true;
+      }
+      previous = chunk[i];
+    }
+  }
+}
+
+void report(const std::string &name, std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) { return samples[static_cast<std::size_t>(q * (samples.size() - 1))]; };
+  std::cout << name << ": p50 " << at(0.5) << " us, p90 " << at(0.9) << " us, p99 " << at(0.99)
+            << " us (" << samples.size() << " queries)\n";
+}
+
+std::vector<double> measure(int iterations, const std::function<bool()> &query) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; ++i) {
+    auto start = clock_type::now();
+    if (!query()) {
+      std::cerr << "error: query failed" << std::endl;
+      break;
+    }
+    samples.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - start).count());
+  }
+  return samples;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <path/to/glob> <pattern> [iterations] [-r]\n";
+    return 1;
+  }
+  const std::string binary = argv[1];
+  const std::string pattern = argv[2];
+  const int iterations = argc > 3 ? std::stoi(argv[3]) : 100;
+  const bool recursive = argc > 4 && std::string(argv[4]) == "-r";
+  const auto socket_path =
+      (glob::fs::temp_directory_path() / ("glob_bench_" + std::to_string(getpid()) + ".sock")).string();
+
+  std::vector<std::string> cold{binary, "-i", pattern};
+  if (recursive) {
+    cold.push_back("-r");
+  }
+  auto cold_samples = measure(iterations, [&] { return run(cold); });
+
+  auto server = spawn({binary, "--serve", socket_path});
+  int fd = -1;
+  for (int attempt = 0; attempt < 100 && fd < 0; ++attempt) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    fd = connect_to(socket_path);
+  }
+  if (server <= 0 || fd < 0) {
+    std::cerr << "error: could not start " << binary << " --serve" << std::endl;
+    return 1;
+  }
+
+  auto client = cold;
+  client.push_back("--connect");
+  client.push_back(socket_path);
+  auto client_samples = measure(iterations, [&] { return run(client); });
+
+  auto request = "d" + glob::fs::current_path().string();
+  request += '\0';
+  request += recursive ? 'r' : 'g';
+  request += pattern;
+  request += std::string(2, '\0');
+  auto socket_samples = measure(iterations, [&] { return roundtrip(fd, request); });
+
+  ::close(fd);
+  kill(server, SIGTERM);
+  waitpid(server, nullptr, 0);
+  ::unlink(socket_path.c_str());
+
+  report("fork per query      ", cold_samples);
+  report("fork + --connect    ", client_samples);
+  report("persistent socket   ", socket_samples);
+  return 0;
+}
+
+#else
+
+int main() {
+  std::cerr << "error: this benchmark requires a POSIX platform" << std::endl;
+  return 1;
+}
+
+#endif
@@ -1,6 +1,16 @@
 
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #ifdef GLOB_USE_GHC_FILESYSTEM
@@ -9,6 +19,10 @@
 #include <filesystem>
 #endif
 
+/// Every function in this library is reentrant and may be called from many threads at once.
+/// Objects passed in (a `cache`, a `backend`, a `pattern_set`) may be shared between concurrent
+/// calls; user-defined backends must therefore be safe to use concurrently through `const`.
+
 namespace glob {
 
 #ifdef GLOB_USE_GHC_FILESYSTEM
@@ -45,4 +59,475 @@ std::vector<fs::path> glob(const std::initializer_list<std::string> &pathnames);
 /// Initializer list overload for convenience
 std::vector<fs::path> rglob(const std::initializer_list<std::string> &pathnames);
 
+/// Warm caches that can be shared by many `glob`/`rglob` calls in a long-running process
+///
+/// Holds up to `capacity` compiled patterns and as many directory listings, dropping the least
+/// recently used ones beyond that. A cached listing is reused only as long as the directory's
+/// last write time is unchanged, so entries added or removed since the last call are picked up;
+/// reusing it costs one stat of the directory. Timestamps can be as coarse as 2 seconds, so a
+/// listing read within 2 seconds of the directory's last change is read again next time rather
+/// than trusted. A cache may be used by several threads at once.
+class cache {
+public:
+  explicit cache(std::size_t capacity = 4096);
+  ~cache();
+  cache(const cache &) = delete;
+  cache &operator=(const cache &) = delete;
+
+  /// Drops all cached patterns and directory listings
+  void clear();
+
+  /// Number of directory listings held
+  std::size_t size() const;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+  friend struct cache_access;
+};
+
+/// Same as `glob`, but answers from (and warms) `c`
+std::vector<fs::path> glob(const std::string &pathname, cache &c);
+
+/// Same as `rglob`, but answers from (and warms) `c`
+std::vector<fs::path> rglob(const std::string &pathname, cache &c);
+
+/// Runs `glob` against each pathname in `pathnames` using `c` and accumulates the results
+std::vector<fs::path> glob(const std::vector<std::string> &pathnames, cache &c);
+
+/// Runs `rglob` against each pathname in `pathnames` using `c` and accumulates the results
+std::vector<fs::path> rglob(const std::vector<std::string> &pathnames, cache &c);
+
+/// Same as `glob`, but the result vector, every directory listing and every intermediate list
+/// built during the walk are allocated from `resource`, e.g. a
+/// `std::pmr::monotonic_buffer_resource` owned by the request and released in one shot.
+/// `fs::path` has no allocator support, so the path strings themselves still come from the
+/// global heap.
+std::pmr::vector<fs::path> glob(const std::string &pathname, std::pmr::memory_resource *resource);
+
+/// Same as `rglob`, allocating the result and intermediate lists from `resource`
+std::pmr::vector<fs::path> rglob(const std::string &pathname, std::pmr::memory_resource *resource);
+
+/// Runs `glob` against each pathname in `pathnames`, allocating from `resource`
+std::pmr::vector<fs::path> glob(const std::vector<std::string> &pathnames,
+                                std::pmr::memory_resource *resource);
+
+/// Runs `rglob` against each pathname in `pathnames`, allocating from `resource`
+std::pmr::vector<fs::path> rglob(const std::vector<std::string> &pathnames,
+                                 std::pmr::memory_resource *resource);
+
+/// What a `backend` reports about a file, following symlinks
+struct file_metadata {
+  fs::file_type type = fs::file_type::not_found;
+  std::uintmax_t size = 0;                          ///< size in bytes, as reported by stat
+  std::chrono::system_clock::time_point mtime = {}; ///< last modification of the contents
+  std::chrono::system_clock::time_point ctime = {}; ///< last status change
+};
+
+/// The filesystem operations the glob engine is built on. Implement it to glob over something
+/// other than the real filesystem, e.g. the central directory of an archive.
+///
+/// Paths are passed as the engine builds them from the pattern: absolute, or relative to the
+/// backend's notion of a current directory.
+class backend {
+public:
+  struct entry {
+    fs::path name;     ///< file name, without directory
+    bool is_directory; ///< true for directories and symlinks to directories
+    /// The type (following symlinks) if the listing already knows it, e.g. from `d_type`;
+    /// fs::file_type::unknown makes the engine ask `stat` when it needs the type
+    fs::file_type type = fs::file_type::unknown;
+  };
+
+  /// Listings are allocated from the memory resource of the call that asked for them
+  using entry_list = std::pmr::vector<entry>;
+
+  virtual ~backend() = default;
+
+  /// Appends the entries of directory `dirname` to `entries`, excluding "." and ".."
+  /// An empty `dirname` denotes the current directory.
+  /// \return false if `dirname` does not exist or is not a listable directory
+  virtual bool list(const fs::path &dirname, entry_list &entries) const = 0;
+
+  /// \return the type of `path` (following symlinks), or fs::file_type::not_found if it does not
+  /// exist. An empty path does not exist.
+  virtual fs::file_type type(const fs::path &path) const = 0;
+
+  /// Fills `metadata` for `path`, following symlinks. Only called when metadata predicates
+  /// (see `options::predicates`) need more than the listing provides. The default reports the
+  /// type only.
+  /// \return false if `path` does not exist
+  virtual bool stat(const fs::path &path, file_metadata &metadata) const;
+};
+
+/// The real filesystem, through std::filesystem. Used when no backend is given.
+class disk_backend : public backend {
+public:
+  bool list(const fs::path &dirname, entry_list &entries) const override;
+  fs::file_type type(const fs::path &path) const override;
+  bool stat(const fs::path &path, file_metadata &metadata) const override;
+};
+
+/// An in-memory directory tree, e.g. built from an archive's entry list or by tests
+///
+/// The current directory of the tree is ".", so relative and absolute paths live side by side.
+class memory_backend : public backend {
+public:
+  /// Adds a regular file, creating missing parent directories
+  void add_file(const fs::path &path, std::uintmax_t size = 0,
+                std::chrono::system_clock::time_point mtime = {});
+
+  /// Adds a directory, creating missing parent directories
+  void add_directory(const fs::path &path);
+
+  bool list(const fs::path &dirname, entry_list &entries) const override;
+  fs::file_type type(const fs::path &path) const override;
+  bool stat(const fs::path &path, file_metadata &metadata) const override;
+
+private:
+  void add(const fs::path &path, const file_metadata &metadata);
+
+  std::map<std::string, file_metadata> nodes_;
+  std::map<std::string, std::vector<entry>> children_;
+};
+
+/// Conditions on the metadata of matches, checked during the walk so that rejected entries never
+/// become results. The type comes from the directory listing where the backend knows it; a
+/// single stat per candidate is issued only when a condition needs more. Candidates whose
+/// metadata cannot be read are rejected.
+struct metadata_predicates {
+  using time_point = std::chrono::system_clock::time_point;
+
+  /// Required type, following symlinks; fs::file_type::none accepts any type
+  fs::file_type type = fs::file_type::none;
+
+  /// Accepted sizes in bytes, inclusive
+  std::uintmax_t min_size = 0;
+  std::uintmax_t max_size = std::numeric_limits<std::uintmax_t>::max();
+
+  /// Accepted modification times, inclusive
+  time_point min_mtime = time_point::min();
+  time_point max_mtime = time_point::max();
+
+  /// Accepted status change times, inclusive
+  time_point min_ctime = time_point::min();
+  time_point max_ctime = time_point::max();
+
+  /// Called last with the match (as it would be returned) and its metadata
+  std::function<bool(const fs::path &, const file_metadata &)> predicate;
+};
+
+/// Options controlling how patterns are matched against names
+struct options {
+  /// Match names regardless of the case of ASCII letters, e.g. `*.JPG` also matches `photo.jpg`.
+  /// Literal path components are then resolved by listing their parent directory, since every
+  /// spelling (`Makefile`, `MAKEFILE`, ...) has to be found. Directories on the way are probed
+  /// by their exact spelling first, and their parent is listed only if that does not exist.
+  bool case_insensitive = false;
+
+  /// With `case_insensitive`, also fold non-ASCII letters of UTF-8 names using Unicode simple
+  /// case folding (Latin, Greek, Cyrillic, Armenian and fullwidth Latin letters)
+  bool unicode_case_folding = false;
+
+  /// Filesystem to glob over; nullptr means the real filesystem
+  const class backend *backend = nullptr;
+
+  /// Directory that relative patterns are rooted at, instead of the process's current directory.
+  /// Results for relative patterns stay relative (to `base_dir`), so several threads can glob
+  /// under different roots without `chdir`.
+  fs::path base_dir;
+
+  /// Number of directory listings and existence probes kept in flight. Above 1, that many worker
+  /// threads list subdirectories and sibling directories ahead of the walk, hiding round trips on
+  /// network and FUSE filesystems. Results are the same as with sequential I/O.
+  unsigned io_concurrency = 1;
+
+  /// Conditions matches have to meet besides matching the pattern
+  metadata_predicates predicates;
+};
+
+/// Same as `glob`, matching according to `opts`
+std::vector<fs::path> glob(const std::string &pathname, const options &opts);
+
+/// Same as `rglob`, matching according to `opts`
+std::vector<fs::path> rglob(const std::string &pathname, const options &opts);
+
+/// Runs `glob` against each pathname in `pathnames` according to `opts`
+std::vector<fs::path> glob(const std::vector<std::string> &pathnames, const options &opts);
+
+/// Runs `rglob` against each pathname in `pathnames` according to `opts`
+std::vector<fs::path> rglob(const std::vector<std::string> &pathnames, const options &opts);
+
+/// Same as `glob`, matching according to `opts` and answering from (and warming) `c`. The cache
+/// holds listings of the real filesystem, so `opts.backend` has to be null or a `disk_backend`
+/// (std::invalid_argument otherwise); `opts.io_concurrency` is ignored.
+std::vector<fs::path> glob(const std::string &pathname, cache &c, const options &opts);
+
+/// Same as `rglob`, matching according to `opts` and answering from (and warming) `c`
+std::vector<fs::path> rglob(const std::string &pathname, cache &c, const options &opts);
+
+/// Runs `glob` against each pathname in `pathnames` according to `opts`, using `c`
+std::vector<fs::path> glob(const std::vector<std::string> &pathnames, cache &c, const options &opts);
+
+/// Runs `rglob` against each pathname in `pathnames` according to `opts`, using `c`
+std::vector<fs::path> rglob(const std::vector<std::string> &pathnames, cache &c, const options &opts);
+
+/// Matches stored compactly: each directory once in a shared table, and the names in it
+/// front-coded (as the length shared with the previous name plus the remaining bytes) in one
+/// contiguous buffer. A few million matches take a few bytes each beyond their unique suffixes
+/// instead of one heap-allocated `fs::path` apiece.
+///
+/// Iteration decodes one match at a time; `fs::path` objects are only built on demand.
+class compact_paths {
+public:
+  /// An input iterator: each match is decoded into a buffer inside the iterator, so the views it
+  /// returns are overwritten when it is advanced and dangle once it is destroyed, e.g.
+  /// `std::string_view s = *paths.begin();`. Copy a match into a `std::string` to keep it.
+  class const_iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    const_iterator() = default;
+
+    /// The whole match, valid until the iterator is advanced
+    std::string_view operator*() const { return path_; }
+    const_iterator &operator++();
+    const_iterator operator++(int);
+
+    /// The directory part of the match, empty if it has none
+    std::string_view directory() const;
+    /// The match without its directory part
+    std::string_view filename() const { return name_; }
+    /// The match as an `fs::path`
+    fs::path path() const { return fs::path(path_); }
+
+    bool operator==(const const_iterator &other) const { return offset_ == other.offset_; }
+    bool operator!=(const const_iterator &other) const { return offset_ != other.offset_; }
+
+  private:
+    friend class compact_paths;
+    const_iterator(const compact_paths *paths, std::size_t offset);
+    void decode();
+
+    const compact_paths *paths_ = nullptr;
+    std::size_t offset_ = 0; ///< of the current record; the end of the records at the end
+    std::size_t next_ = 0;   ///< of the following record
+    std::size_t directory_ = 0;
+    std::string name_;
+    std::string path_;
+  };
+
+  void push_back(std::string_view path);
+  void push_back(const std::string &path) { push_back(std::string_view(path)); }
+  void push_back(const char *path) { push_back(std::string_view(path)); }
+  void push_back(const fs::path &path);
+
+  /// Same as `push_back(fs::path(dirname) / name)`, without building the joined path
+  void push_back(std::string_view dirname, std::string_view name);
+
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, records_.size()); }
+
+  /// Every match as an `fs::path`, in order
+  std::vector<fs::path> to_paths() const;
+
+  /// Approximate number of heap bytes held, including the directory lookup
+  std::size_t memory_usage() const noexcept;
+
+private:
+  /// The directory with id `id`; id 0 is "no directory"
+  std::string_view directory_name(std::size_t id) const;
+  /// The id of the directory `dirname`, added to the table if new
+  std::size_t directory_id(std::string_view dirname);
+  /// Appends the record of `name` in the directory with id `directory`
+  void append(std::size_t directory, std::string_view name);
+
+  std::string directories_;                  ///< every directory, back to back
+  std::vector<std::size_t> directory_ends_;  ///< end of each directory in `directories_`
+  std::vector<std::size_t> directory_slots_; ///< open-addressing table of directory ids, 0 if free
+  std::vector<unsigned char> records_;       ///< one front-coded record per match
+  std::string last_name_;
+  std::size_t last_directory_ = 0;           ///< id of the last record's directory
+  std::size_t size_ = 0;
+};
+
+/// Same as `glob`, storing the matches compactly
+compact_paths glob_compact(const std::string &pathname, const options &opts = {});
+
+/// Same as `rglob`, storing the matches compactly
+compact_paths rglob_compact(const std::string &pathname, const options &opts = {});
+
+/// Runs `glob` against each pathname in `pathnames`, storing the matches compactly
+compact_paths glob_compact(const std::vector<std::string> &pathnames, const options &opts = {});
+
+/// Runs `rglob` against each pathname in `pathnames`, storing the matches compactly
+compact_paths rglob_compact(const std::vector<std::string> &pathnames, const options &opts = {});
+
+/// One page of matches and where the next one starts
+struct page {
+  std::vector<fs::path> matches;
+  /// Opaque position after the last match, to pass to the next call; empty after the last page
+  std::string resume_token;
+};
+
+/// Same as `glob`, but returns at most `count` matches, starting after the position encoded in
+/// `resume_token` (empty for the first page). Directories are listed in sorted order and walked
+/// depth first, so matches come in a stable order, which differs from `glob`'s. A resumed walk
+/// lists only the directories on the way to the resume position and those after it; the ones
+/// already fully emitted are not read again. Matches added or removed between calls are seen or
+/// missed according to where they sort relative to the resume position.
+/// A token is only accepted for the same pattern, case folding and `options::base_dir`. It does
+/// not identify the backend: resuming against another filesystem continues at the same sorted
+/// position there.
+/// \throws std::invalid_argument if `count` is 0 or the token is malformed or was returned for
+/// another pattern or base directory
+page glob_page(const std::string &pathname, std::size_t count, const std::string &resume_token = {},
+               const options &opts = {});
+
+/// Same as `glob_page` for `rglob`
+page rglob_page(const std::string &pathname, std::size_t count, const std::string &resume_token = {},
+                const options &opts = {});
+
+/// Limits on the work of a single call, checked inside the walk. Bounded calls do their I/O on
+/// the calling thread, one operation at a time, so `options::io_concurrency` is ignored: listings
+/// running ahead in worker threads could neither be charged nor interrupted at the deadline.
+struct budget {
+  /// When to give up; checked before every directory listing and existence probe
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  /// Directories listed
+  std::size_t max_directories = std::numeric_limits<std::size_t>::max();
+  /// Directory entries examined, across all listings
+  std::size_t max_entries = std::numeric_limits<std::size_t>::max();
+  /// Matches returned
+  std::size_t max_results = std::numeric_limits<std::size_t>::max();
+};
+
+/// Why a bounded call returned
+enum class budget_status {
+  complete,    ///< every match was found
+  deadline,    ///< the deadline passed
+  directories, ///< `max_directories` directories were listed and another one was needed
+  entries,     ///< `max_entries` entries were examined; the last listing was cut short
+  results,     ///< more than `max_results` matches exist; the first `max_results` are returned
+};
+
+/// Matches of a bounded call: all of them if `status` is `complete`, otherwise the ones found
+/// before the budget ran out
+struct bounded_result {
+  std::vector<fs::path> matches;
+  budget_status status = budget_status::complete;
+};
+
+/// Same as `glob`, but stops as soon as any limit of `limits` is reached
+bounded_result glob_bounded(const std::string &pathname, const budget &limits, const options &opts = {});
+
+/// Same as `rglob`, but stops as soon as any limit of `limits` is reached
+bounded_result rglob_bounded(const std::string &pathname, const budget &limits, const options &opts = {});
+
+/// Runs `glob` against each pathname in `pathnames` until any limit of `limits` is reached
+bounded_result glob_bounded(const std::vector<std::string> &pathnames, const budget &limits,
+                            const options &opts = {});
+
+/// Runs `rglob` against each pathname in `pathnames` until any limit of `limits` is reached
+bounded_result rglob_bounded(const std::vector<std::string> &pathnames, const budget &limits,
+                             const options &opts = {});
+
+/// How a pattern is executed: the literal directory the walk starts in, then one step per
+/// remaining segment of the pattern, each run over every path the previous step produced
+struct plan {
+  enum class step_kind {
+    literal,   ///< one or more literal components, e.g. "include/glob"
+    wildcard,  ///< a component with wildcards, e.g. "*.h"
+    recursive, ///< `**` in `rglob`: the directory itself and everything below it
+    dironly,   ///< a trailing '/': directories only
+  };
+
+  /// The I/O a step costs for each path it is run over
+  enum class io_kind {
+    none,  ///< nothing; answered by the previous step's listing
+    probe, ///< one existence check of a single path
+    list,  ///< one directory listing
+    walk,  ///< one directory listing per directory in the subtree
+  };
+
+  struct step {
+    step_kind kind;
+    std::string segment; ///< the part of the pattern the step matches; empty for `dironly`
+    io_kind io;
+  };
+
+  fs::path start; ///< directory the walk starts in; empty for the current directory
+  std::vector<step> steps;
+
+  /// The plan as text, one line per step with its estimated I/O
+  std::string str() const;
+};
+
+/// Plans `glob` (or `rglob`, if `recursive`) of `pathname` according to `opts`, without touching
+/// the filesystem. Consecutive literal components are probed as one path and each wildcard
+/// component lists a directory once, so e.g. "src/*/include/glob/*.h" costs one listing of
+/// "src", one probe per subdirectory and one listing per "include/glob" found.
+plan explain(const std::string &pathname, bool recursive = false, const options &opts = {});
+
+/// A set of patterns compiled for matching path strings in memory, without touching the
+/// filesystem, e.g. to filter a manifest of object-store keys.
+///
+/// Paths are matched component by component, with `**` (when `recursive`) matching zero or more
+/// components as in `rglob`. Wildcards never match components starting with '.', `**` never
+/// spans them, and a pattern ending with '/' only matches paths ending with '/'. Empty and "."
+/// components are ignored; `~` is not expanded.
+class pattern_set {
+public:
+  explicit pattern_set(const std::vector<std::string> &patterns, bool recursive = true,
+                       const options &opts = {});
+  ~pattern_set();
+  pattern_set(pattern_set &&) noexcept;
+  pattern_set &operator=(pattern_set &&) noexcept;
+
+  /// \return true if any pattern matches `path`
+  bool match(std::string_view path) const;
+
+  /// Matches `count` paths starting at `paths` in batches spread over `threads` worker threads
+  /// (0 uses std::thread::hardware_concurrency())
+  /// \return ascending indices of the paths matched by any pattern
+  std::vector<std::size_t> filter(const std::string_view *paths, std::size_t count,
+                                  unsigned threads = 0) const;
+
+  /// Overload for a vector of string views
+  std::vector<std::size_t> filter(const std::vector<std::string_view> &paths,
+                                  unsigned threads = 0) const;
+
+  /// Overload for a vector of strings
+  std::vector<std::size_t> filter(const std::vector<std::string> &paths, unsigned threads = 0) const;
+
+  /// \return the compiled set as a self-contained binary blob, in the native byte order and
+  /// tagged with a format version
+  std::vector<unsigned char> serialize() const;
+
+  /// Uses a blob produced by `serialize()` in place: nothing is copied or recompiled, the blob is
+  /// only validated. `data` must be 8-byte aligned and stay valid and unchanged for the lifetime
+  /// of the returned set.
+  /// \throws std::invalid_argument if the blob is malformed, or was written by an incompatible
+  /// version or on a machine with a different byte order
+  static pattern_set deserialize(const void *data, std::size_t size);
+
+  /// Maps a file holding a blob produced by `serialize()` read-only and shared, so processes
+  /// loading the same file share its pages
+  /// \throws std::invalid_argument as `deserialize`, std::system_error if the file cannot be mapped
+  static pattern_set map_file(const fs::path &path);
+
+private:
+  pattern_set();
+
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
 } // namespace glob
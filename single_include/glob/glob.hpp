@@ -24,13 +24,41 @@ namespace fs = std::filesystem;
 
 namespace {
 
+// The std::regex spelling of the shell set `stuff` (the text between the brackets). Every member
+// is escaped, so ']' and '[' members, '^', '-' and reversed ranges (which match nothing) keep
+// their shell meaning.
 static inline 
-bool string_replace(std::string &str, const std::string &from, const std::string &to) {
-  std::size_t start_pos = str.find(from);
-  if (start_pos == std::string::npos)
-    return false;
-  str.replace(start_pos, from.length(), to);
-  return true;
+std::string regex_set(const std::string &stuff) {
+  const bool negated = !stuff.empty() && stuff[0] == '!';
+  const std::size_t begin = negated ? 1 : 0;
+
+  bool set[256] = {};
+  for (std::size_t k = begin; k < stuff.size(); ++k) {
+    const auto first = static_cast<unsigned char>(stuff[k]);
+    if (k + 2 < stuff.size() && stuff[k + 1] == '-') {
+      const auto last = static_cast<unsigned char>(stuff[k + 2]);
+      for (unsigned ch = first; ch <= last; ++ch) {
+        set[ch] = true;
+      }
+      k += 2;
+    } else {
+      set[first] = true;
+    }
+  }
+
+  static const char hex_digits[] = "0123456789abcdef";
+  std::string members;
+  for (unsigned ch = 0; ch < 256; ++ch) {
+    if (set[ch]) {
+      members += "\\x";
+      members += hex_digits[ch >> 4];
+      members += hex_digits[ch & 15];
+    }
+  }
+  if (members.empty()) {
+    return negated ? "[\\s\\S]" : "[^\\s\\S]";
+  }
+  return (negated ? "[^" : "[") + members + "]";
 }
 
 static inline 
@@ -59,58 +87,8 @@ std::string translate(const std::string &pattern) {
       if (j >= n) {
         result_string += "\\[";
       } else {
-        auto stuff = std::string(pattern.begin() + i, pattern.begin() + j);
-        if (stuff.find("--") == std::string::npos) {
-          string_replace(stuff, std::string{"\\"}, std::string{R"(\\)"});
-        } else {
-          std::vector<std::string> chunks;
-          std::size_t k = 0;
-          if (pattern[i] == '!') {
-            k = i + 2;
-          } else {
-            k = i + 1;
-          }
-
-          while (true) {
-            k = pattern.find("-", k, j);
-            if (k == std::string::npos) {
-              break;
-            }
-            chunks.push_back(std::string(pattern.begin() + i, pattern.begin() + k));
-            i = k + 1;
-            k = k + 3;
-          }
-
-          chunks.push_back(std::string(pattern.begin() + i, pattern.begin() + j));
-          // Escape backslashes and hyphens for set difference (--).
-          // Hyphens that create ranges shouldn't be escaped.
-          bool first = false;
-          for (auto &s : chunks) {
-            string_replace(s, std::string{"\\"}, std::string{R"(\\)"});
-            string_replace(s, std::string{"-"}, std::string{R"(\-)"});
-            if (first) {
-              stuff += s;
-              first = false;
-            } else {
-              stuff += "-" + s;
-            }
-          }
-        }
-
-        // Escape set operations (&&, ~~ and ||).
-        std::string result;
-        std::regex_replace(std::back_inserter(result),          // result
-                           stuff.begin(), stuff.end(),          // string
-                           std::regex(std::string{R"([&~|])"}), // pattern
-                           std::string{R"(\\\1)"});             // repl
-        stuff = result;
+        result_string += regex_set(std::string(pattern.begin() + i, pattern.begin() + j));
         i = j + 1;
-        if (stuff[0] == '!') {
-          stuff = "^" + std::string(stuff.begin() + 1, stuff.end());
-        } else if (stuff[0] == '^' || stuff[0] == '[') {
-          stuff = "\\\\" + stuff;
-        }
-        result_string = result_string + "[" + stuff + "]";
       }
     } else {
       // SPECIAL_CHARS
@@ -118,17 +96,11 @@ std::string translate(const std::string &pattern) {
       // '-' (a range in character set)
       // '&', '~', (extended character set operations)
       // '#' (comment) and WHITESPACE (ignored) in verbose mode
-      static std::string special_characters = "()[]{}?*+-|^$\\.&~# \t\n\r\v\f";
-      static std::map<int, std::string> special_characters_map;
-      if (special_characters_map.empty()) {
-        for (auto &sc : special_characters) {
-          special_characters_map.insert(
-              std::make_pair(static_cast<int>(sc), std::string{"\\"} + std::string(1, sc)));
-        }
-      }
+      static const std::string special_characters = "()[]{}?*+-|^$\\.&~# \t\n\r\v\f";
 
       if (special_characters.find(c) != std::string::npos) {
-        result_string += special_characters_map[static_cast<int>(c)];
+        result_string += '\\';
+        result_string += c;
       } else {
         result_string += c;
       }
@@ -207,8 +179,7 @@ fs::path expand_tilde(fs::path path) {
 
 static inline 
 bool has_magic(const std::string &pathname) {
-  static const auto magic_check = std::regex("([*?[])");
-  return std::regex_search(pathname, magic_check);
+  return pathname.find_first_of("*?[") != std::string::npos;
 }
 
 static inline 
@@ -1,28 +1,521 @@
 #include <glob/glob.h>
 
+#include "matcher.h"
+
 #include <cassert>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <list>
 #include <map>
+#include <mutex>
+#include <optional>
 #include <regex>
+#include <sstream>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 
 namespace glob {
 
+struct directory_listing {
+  struct entry {
+    fs::path filename;
+    bool is_directory;
+  };
+  fs::file_time_type last_write_time;
+  fs::file_time_type listed_at; ///< when the entries were read
+  std::vector<entry> entries;
+};
+
+namespace {
+
+// A map holding at most `capacity` values, dropping the least recently used ones
+template <typename Key, typename Value> class lru_map {
+public:
+  explicit lru_map(std::size_t capacity) : capacity_(capacity) {}
+
+  // The value of `key`, now the most recently used; nullptr if there is none
+  const Value *find(const Key &key) {
+    auto it = index_.find(std::cref(key));
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+  }
+
+  void put(const Key &key, Value value) {
+    auto it = index_.find(std::cref(key));
+    if (it != index_.end()) {
+      it->second->second = std::move(value);
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return;
+    }
+    entries_.emplace_front(key, std::move(value));
+    index_.emplace(std::cref(entries_.front().first), entries_.begin());
+    if (entries_.size() > capacity_) {
+      index_.erase(std::cref(entries_.back().first));
+      entries_.pop_back();
+    }
+  }
+
+  std::size_t size() const noexcept { return entries_.size(); }
+
+  void clear() {
+    index_.clear();
+    entries_.clear();
+  }
+
+private:
+  using entry_list = std::list<std::pair<Key, Value>>;
+
+  std::size_t capacity_;
+  entry_list entries_; // most recently used first
+  // Refers to the keys held in `entries_`, so each is stored once
+  std::map<std::reference_wrapper<const Key>, typename entry_list::iterator, std::less<Key>> index_;
+};
+
+// The coarsest timestamp granularity in common use (FAT; ext3 and HFS+ have 1 s). A directory
+// changed this close to when it was listed may have changed again without its last write time
+// changing.
+constexpr auto MTIME_GRANULARITY = std::chrono::seconds(2);
+
+} // namespace
+
+struct cache::impl {
+  explicit impl(std::size_t capacity) : patterns(capacity), listings(capacity) {}
+
+  std::mutex mutex;
+  lru_map<std::string, std::shared_ptr<const std::regex>> patterns;
+  lru_map<fs::path, std::shared_ptr<const directory_listing>> listings;
+};
+
+namespace {
+std::regex compile_pattern(std::string_view pattern);
+}
+
+// Lookups into a `cache`. Compilation and directory reads happen outside the lock, so
+// two threads missing on the same key may both do the work; the last one wins.
+struct cache_access {
+  static std::shared_ptr<const std::regex> pattern(cache &c, std::string_view pattern) {
+    const auto key = std::string(pattern);
+    {
+      std::lock_guard<std::mutex> lock(c.impl_->mutex);
+      if (auto found = c.impl_->patterns.find(key)) {
+        return *found;
+      }
+    }
+    auto compiled = std::make_shared<const std::regex>(compile_pattern(pattern));
+    std::lock_guard<std::mutex> lock(c.impl_->mutex);
+    c.impl_->patterns.put(key, compiled);
+    return compiled;
+  }
+
+  // A hit costs one stat of `dirname`. nullptr if `dirname` does not exist; throws (like
+  // fs::directory_iterator) if it cannot be listed.
+  static std::shared_ptr<const directory_listing> listing(cache &c, const fs::path &dirname) {
+    const auto key = fs::absolute(dirname);
+    std::error_code ec;
+    const auto last_write_time = fs::last_write_time(key, ec);
+    if (ec) {
+      return nullptr;
+    }
+    {
+      std::lock_guard<std::mutex> lock(c.impl_->mutex);
+      auto found = c.impl_->listings.find(key);
+      // A listing read in the same timestamp tick as the last change may have missed a later
+      // change in that tick, so it is only trusted once read at least a tick later
+      if (found && (*found)->last_write_time == last_write_time &&
+          last_write_time + MTIME_GRANULARITY < (*found)->listed_at) {
+        return *found;
+      }
+    }
+    auto listing = std::make_shared<directory_listing>();
+    listing->last_write_time = last_write_time;
+    listing->listed_at = fs::file_time_type::clock::now();
+    for (auto &entry : fs::directory_iterator(
+            key, fs::directory_options::follow_directory_symlink |
+                     fs::directory_options::skip_permission_denied)) {
+      listing->entries.push_back({entry.path().filename(), entry.is_directory()});
+    }
+    std::lock_guard<std::mutex> lock(c.impl_->mutex);
+    c.impl_->listings.put(key, listing);
+    return listing;
+  }
+
+  static std::size_t size(const cache &c) {
+    std::lock_guard<std::mutex> lock(c.impl_->mutex);
+    return c.impl_->listings.size();
+  }
+};
+
+cache::cache(std::size_t capacity) : impl_(std::make_unique<impl>(capacity)) {}
+
+cache::~cache() = default;
+
+void cache::clear() {
+  std::lock_guard<std::mutex> lock(impl_->mutex);
+  impl_->patterns.clear();
+  impl_->listings.clear();
+}
+
+std::size_t cache::size() const { return cache_access::size(*this); }
+
 namespace {
 
+enum class case_folding { none, ascii, unicode };
+
+// Maps every byte to itself, or 'A'-'Z' to 'a'-'z' when folding
+constexpr std::array<unsigned char, 256> make_fold_table(bool fold_ascii) {
+  std::array<unsigned char, 256> table{};
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    table[i] = static_cast<unsigned char>(fold_ascii && i >= 'A' && i <= 'Z' ? i + ('a' - 'A') : i);
+  }
+  return table;
+}
+
+constexpr auto IDENTITY_TABLE = make_fold_table(false);
+constexpr auto ASCII_FOLD_TABLE = make_fold_table(true);
+
+// Unicode simple case folding (CaseFolding.txt, status C and S) for the Latin, Greek, Cyrillic,
+// Armenian, letterlike and fullwidth Latin blocks. Other code points fold to themselves.
+std::uint32_t simple_fold(std::uint32_t cp) {
+  const auto pair_if = [cp](std::uint32_t first, std::uint32_t last, std::uint32_t parity) {
+    return cp >= first && cp <= last && (cp & 1) == parity;
+  };
+  if (cp < 0x80) {
+    return ASCII_FOLD_TABLE[cp];
+  }
+  if ((cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) || (cp >= 0x391 && cp <= 0x3AB && cp != 0x3A2) ||
+      (cp >= 0x410 && cp <= 0x42F) || (cp >= 0xFF21 && cp <= 0xFF3A)) {
+    return cp + 0x20;
+  }
+  if (pair_if(0x100, 0x12F, 0) || pair_if(0x132, 0x137, 0) || pair_if(0x139, 0x148, 1) ||
+      pair_if(0x14A, 0x177, 0) || pair_if(0x179, 0x17E, 1) || pair_if(0x460, 0x481, 0) ||
+      pair_if(0x48A, 0x4BF, 0) || pair_if(0x4C1, 0x4CE, 1) || pair_if(0x4D0, 0x52F, 0) ||
+      pair_if(0x1E00, 0x1E95, 0) || pair_if(0x1EA0, 0x1EFF, 0)) {
+    return cp + 1;
+  }
+  if (cp >= 0x400 && cp <= 0x40F) {
+    return cp + 0x50;
+  }
+  if (cp >= 0x531 && cp <= 0x556) {
+    return cp + 0x30;
+  }
+  if (cp >= 0x388 && cp <= 0x38A) {
+    return cp + 0x25;
+  }
+  if (cp >= 0x2160 && cp <= 0x216F) {
+    return cp + 0x10;
+  }
+  if (cp >= 0x24B6 && cp <= 0x24CF) {
+    return cp + 0x1A;
+  }
+  switch (cp) {
+  case 0xB5: return 0x3BC;
+  case 0x178: return 0xFF;
+  case 0x17F: return 's';
+  case 0x386: return 0x3AC;
+  case 0x38C: return 0x3CC;
+  case 0x38E: return 0x3CD;
+  case 0x38F: return 0x3CE;
+  case 0x3C2: return 0x3C3;
+  case 0x4C0: return 0x4CF;
+  case 0x1E9E: return 0xDF;
+  case 0x2126: return 0x3C9;
+  case 0x212A: return 'k';
+  case 0x212B: return 0xE5;
+  default: return cp;
+  }
+}
+
+void append_utf8(std::string &out, std::uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// Applies `simple_fold` to each UTF-8 encoded code point; bytes that are not part of a valid
+// sequence are copied unchanged.
+std::string fold_utf8(std::string_view s) {
+  std::string result;
+  result.reserve(s.size());
+  std::size_t i = 0;
+  while (i < s.size()) {
+    const auto lead = static_cast<unsigned char>(s[i]);
+    const std::size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3
+                             : (lead >> 3) == 0x1E ? 4 : 0;
+    bool valid = length != 0 && i + length <= s.size();
+    std::uint32_t cp = length == 1 ? lead : lead & (0x7F >> length);
+    for (std::size_t k = 1; valid && k < length; ++k) {
+      const auto next = static_cast<unsigned char>(s[i + k]);
+      valid = (next & 0xC0) == 0x80;
+      cp = (cp << 6) | (next & 0x3F);
+    }
+    if (!valid) {
+      result += s[i++];
+      continue;
+    }
+    append_utf8(result, simple_fold(cp));
+    i += length;
+  }
+  return result;
+}
+
+std::string fold(std::string_view s, case_folding folding) {
+  if (folding == case_folding::unicode) {
+    return fold_utf8(s);
+  }
+  std::string result(s);
+  if (folding == case_folding::ascii) {
+    for (auto &ch : result) {
+      ch = static_cast<char>(ASCII_FOLD_TABLE[static_cast<unsigned char>(ch)]);
+    }
+  }
+  return result;
+}
+
+// Shell patterns for single path components are compiled to a flat token list that is matched
+// directly, instead of through `translate()` and std::regex. The records are trivially copyable
+// so a compiled `pattern_set` can be written out and used in place from mapped memory.
+
+enum class token_kind : std::uint8_t { literal, any, star, set };
+
+struct token {
+  token_kind kind;
+  std::uint8_t ch;        // literal
+  std::uint8_t negated;   // set
+  std::uint8_t unused;
+  std::uint32_t set_index; // set
+};
+
+struct charset {
+  std::uint64_t bits[4];
+
+  void set(unsigned char ch) { bits[ch >> 6] |= std::uint64_t{1} << (ch & 63); }
+  bool test(unsigned char ch) const { return (bits[ch >> 6] >> (ch & 63)) & 1; }
+};
+
+static_assert(sizeof(token) == 8 && std::is_trivially_copyable_v<token>);
+static_assert(sizeof(charset) == 32 && std::is_trivially_copyable_v<charset>);
+
+const unsigned char *fold_table(case_folding folding) {
+  return folding == case_folding::none ? IDENTITY_TABLE.data() : ASCII_FOLD_TABLE.data();
+}
+
+// The members of a shell set, given the text between the brackets after any '!'
+charset parse_set(std::string_view stuff) {
+  charset set{};
+  for (std::size_t k = 0; k < stuff.size(); ++k) {
+    const auto first = static_cast<unsigned char>(stuff[k]);
+    if (k + 2 < stuff.size() && stuff[k + 1] == '-') {
+      // Reversed ranges such as 'z-a' match nothing
+      const auto last = static_cast<unsigned char>(stuff[k + 2]);
+      for (unsigned ch = first; ch <= last; ++ch) {
+        set.set(static_cast<unsigned char>(ch));
+      }
+      k += 2;
+    } else {
+      set.set(first);
+    }
+  }
+  return set;
+}
+
+void compile_set(std::string_view stuff, case_folding folding, std::vector<token> &tokens,
+                 std::vector<charset> &sets) {
+  const bool negated = !stuff.empty() && stuff[0] == '!';
+  if (negated) {
+    stuff.remove_prefix(1);
+  }
+  auto set = parse_set(stuff);
+  // Names are folded before matching, so a set must accept the folded form of its members
+  const auto table = fold_table(folding);
+  for (unsigned ch = 0; ch < 256; ++ch) {
+    if (set.test(static_cast<unsigned char>(ch))) {
+      set.set(table[ch]);
+    }
+  }
+  tokens.push_back({token_kind::set, 0, negated, 0, static_cast<std::uint32_t>(sets.size())});
+  sets.push_back(set);
+}
+
+// Appends the tokens of `pattern` to `tokens` (and its character sets to `sets`). Supports the
+// same syntax as `translate()`: '*', '?', '[...]', '[!...]' with ranges; an unterminated '[' is
+// a literal.
+void compile_wildcard(std::string_view pattern, case_folding folding, std::vector<token> &tokens,
+                      std::vector<charset> &sets) {
+  const auto folded = fold(pattern, folding);
+  const std::string_view p = folded;
+  const auto first_token = tokens.size();
+  std::size_t i = 0;
+  const auto n = p.size();
+  while (i < n) {
+    const auto c = static_cast<unsigned char>(p[i++]);
+    if (c == '*') {
+      // consecutive stars are equivalent to one
+      if (tokens.size() == first_token || tokens.back().kind != token_kind::star) {
+        tokens.push_back({token_kind::star, 0, 0, 0, 0});
+      }
+    } else if (c == '?') {
+      tokens.push_back({token_kind::any, 0, 0, 0, 0});
+    } else if (c == '[') {
+      auto j = i;
+      if (j < n && p[j] == '!') {
+        j += 1;
+      }
+      if (j < n && p[j] == ']') {
+        j += 1;
+      }
+      while (j < n && p[j] != ']') {
+        j += 1;
+      }
+      if (j >= n) {
+        tokens.push_back({token_kind::literal, '[', 0, 0, 0});
+        continue;
+      }
+      compile_set(p.substr(i, j - i), folding, tokens, sets);
+      i = j + 1;
+    } else {
+      tokens.push_back({token_kind::literal, c, 0, 0, 0});
+    }
+  }
+}
+
+// Greedy match that backtracks only to the most recent star, so it runs in
+// O(pattern * name) time in the worst case. `name` must already be Unicode-folded if required.
+bool match_tokens(const token *tokens, std::size_t count, const charset *sets,
+                  const unsigned char *table, std::string_view name) {
+  const auto accepts = [&](const token &t, unsigned char ch) {
+    switch (t.kind) {
+    case token_kind::literal: return t.ch == table[ch];
+    case token_kind::any: return true;
+    case token_kind::set: return sets[t.set_index].test(table[ch]) != static_cast<bool>(t.negated);
+    default: return false;
+    }
+  };
+
+  std::size_t t = 0, s = 0;
+  std::size_t star_t = std::string_view::npos, star_s = 0;
+  const auto n = name.size();
+  while (s < n) {
+    if (t < count && tokens[t].kind == token_kind::star) {
+      star_t = t++;
+      star_s = s;
+    } else if (t < count && accepts(tokens[t], static_cast<unsigned char>(name[s]))) {
+      ++t;
+      ++s;
+    } else if (star_t != std::string_view::npos) {
+      t = star_t + 1;
+      s = ++star_s;
+    } else {
+      return false;
+    }
+  }
+  while (t < count && tokens[t].kind == token_kind::star) {
+    ++t;
+  }
+  return t == count;
+}
+
+bool match_tokens(const token *tokens, std::size_t count, const charset *sets,
+                  case_folding folding, std::string_view name) {
+  if (folding == case_folding::unicode) {
+    return match_tokens(tokens, count, sets, fold_table(folding), fold_utf8(name));
+  }
+  return match_tokens(tokens, count, sets, fold_table(folding), name);
+}
+
+// A single compiled shell pattern for one path component
+class wildcard {
+public:
+  wildcard(std::string_view pattern, case_folding folding) : folding_(folding) {
+    compile_wildcard(pattern, folding, tokens_, sets_);
+  }
+
+  bool match(std::string_view name) const {
+    return match_tokens(tokens_.data(), tokens_.size(), sets_.data(), folding_, name);
+  }
+
+private:
+  case_folding folding_;
+  std::vector<token> tokens_;
+  std::vector<charset> sets_;
+};
+
 static constexpr auto SPECIAL_CHARACTERS = std::string_view{"()[]{}?*+-|^$\\.&~# \t\n\r\v\f"};
-static const auto ESCAPE_SET_OPER = std::regex(std::string{R"([&~|])"});
-static const auto ESCAPE_REPL_STR = std::string{R"(\\\1)"};
 
-bool string_replace(std::string &str, std::string_view from, std::string_view to) {
-  std::size_t start_pos = str.find(from);
-  if (start_pos == std::string::npos)
-    return false;
-  str.replace(start_pos, from.length(), to);
-  return true;
+// The std::regex spelling of the shell set `stuff` (the text between the brackets). It is built
+// from the charset the native matcher uses, with every member escaped, so both engines agree on
+// ']' and '[' members, '^', '-' and reversed ranges (which match nothing).
+std::string regex_set(std::string_view stuff) {
+  const bool negated = !stuff.empty() && stuff[0] == '!';
+  const auto set = parse_set(negated ? stuff.substr(1) : stuff);
+
+  const auto append_escaped = [](std::string &out, unsigned ch) {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    out += "\\x";
+    out += HEX_DIGITS[ch >> 4];
+    out += HEX_DIGITS[ch & 15];
+  };
+
+  std::string members;
+  for (unsigned ch = 0; ch < 256; ++ch) {
+    if (!set.test(static_cast<unsigned char>(ch))) {
+      continue;
+    }
+    append_escaped(members, ch);
+    // Ranges only within ASCII, where char signedness cannot reorder them
+    auto last = ch;
+    while (last + 1 < 0x80 && set.test(static_cast<unsigned char>(last + 1))) {
+      ++last;
+    }
+    if (last > ch + 1) {
+      members += '-';
+      append_escaped(members, last);
+      ch = last;
+    }
+  }
+  if (members.empty()) {
+    return negated ? "[\\s\\S]" : "[^\\s\\S]";
+  }
+  return (negated ? "[^" : "[") + members + "]";
 }
 
+// The std::regex (ECMAScript) equivalent of the shell-style wildcard `pattern` for a single path
+// component, as case-sensitive `glob` and `rglob` match it
 std::string translate(std::string_view pattern) {
   std::size_t i = 0, n = pattern.size();
   std::string result_string;
@@ -48,58 +541,8 @@ std::string translate(std::string_view pattern) {
       if (j >= n) {
         result_string += "\\[";
       } else {
-        auto stuff = std::string(pattern.begin() + i, pattern.begin() + j);
-        if (stuff.find("--") == std::string::npos) {
-          string_replace(stuff, std::string_view{"\\"}, std::string_view{R"(\\)"});
-        } else {
-          std::vector<std::string> chunks;
-          std::size_t k = 0;
-          if (pattern[i] == '!') {
-            k = i + 2;
-          } else {
-            k = i + 1;
-          }
-
-          while (true) {
-            k = pattern.find("-", k, j);
-            if (k == std::string_view::npos) {
-              break;
-            }
-            chunks.push_back(std::string(pattern.begin() + i, pattern.begin() + k));
-            i = k + 1;
-            k = k + 3;
-          }
-
-          chunks.push_back(std::string(pattern.begin() + i, pattern.begin() + j));
-          // Escape backslashes and hyphens for set difference (--).
-          // Hyphens that create ranges shouldn't be escaped.
-          bool first = true;
-          for (auto &chunk : chunks) {
-            string_replace(chunk, std::string_view{"\\"}, std::string_view{R"(\\)"});
-            string_replace(chunk, std::string_view{"-"}, std::string_view{R"(\-)"});
-            if (first) {
-              stuff += chunk;
-              first = false;
-            } else {
-              stuff += "-" + chunk;
-            }
-          }
-        }
-
-        // Escape set operations (&&, ~~ and ||).
-        std::string result{};
-        std::regex_replace(std::back_inserter(result), // result
-                           stuff.begin(), stuff.end(), // string
-                           ESCAPE_SET_OPER,            // pattern
-                           ESCAPE_REPL_STR);           // repl
-        stuff = result;
+        result_string += regex_set(pattern.substr(i, j - i));
         i = j + 1;
-        if (stuff[0] == '!') {
-          stuff = "^" + std::string(stuff.begin() + 1, stuff.end());
-        } else if (stuff[0] == '^' || stuff[0] == '[') {
-          stuff = "\\\\" + stuff;
-        }
-        result_string = result_string + "[" + stuff + "]";
       }
     } else {
       // SPECIAL_CHARS
@@ -107,15 +550,9 @@ std::string translate(std::string_view pattern) {
       // '-' (a range in character set)
       // '&', '~', (extended character set operations)
       // '#' (comment) and WHITESPACE (ignored) in verbose mode
-      static std::map<int, std::string> special_characters_map;
-      if (special_characters_map.empty()) {
-        for (auto &&sc : SPECIAL_CHARACTERS) {
-          special_characters_map.emplace(static_cast<int>(sc), std::string{"\\"} + std::string(1, sc));
-        }
-      }
-
       if (SPECIAL_CHARACTERS.find(c) != std::string_view::npos) {
-        result_string += special_characters_map[static_cast<int>(c)];
+        result_string += '\\';
+        result_string += c;
       } else {
         result_string += c;
       }
@@ -128,21 +565,266 @@ std::regex compile_pattern(std::string_view pattern) {
   return std::regex(translate(pattern), std::regex::ECMAScript);
 }
 
-bool fnmatch(std::string&& name, const std::regex& pattern) {
-  return std::regex_match(std::move(name), pattern);
+// Matches without copying the name where the native path format is already narrow
+bool fnmatch(const fs::path &name, const std::regex &pattern) {
+  if constexpr (std::is_same_v<fs::path::value_type, char>) {
+    return std::regex_match(name.native(), pattern);
+  } else {
+    return std::regex_match(name.string(), pattern);
+  }
 }
 
-std::vector<fs::path> filter(const std::vector<fs::path> &names,
-                             std::string_view pattern) {
-  // std::cout << "Pattern: " << pattern << "\n";
-  const auto pattern_re = compile_pattern(pattern);
-  std::vector<fs::path> result;
-  std::copy_if(std::make_move_iterator(names.begin()), std::make_move_iterator(names.end()),
-               std::back_inserter(result),
-               [&pattern_re](const fs::path& name) { return fnmatch(name.string(), pattern_re); });
-  return result;
+const backend &default_backend() {
+  static const disk_backend disk;
+  return disk;
 }
 
+using path_list = std::pmr::vector<fs::path>;
+
+// Runs backend listings and type probes on a pool of worker threads ahead of the walk, so that
+// on high-latency filesystems (NFS, FUSE) up to `concurrency` round trips are in flight at once
+// instead of one. The walk still consumes results in its own order, so output is unchanged.
+class prefetcher {
+public:
+  prefetcher(const backend &fs_backend, unsigned concurrency)
+      : backend_(fs_backend), max_jobs_(concurrency * JOBS_PER_WORKER) {
+    for (unsigned i = 0; i < concurrency; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  ~prefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  prefetcher(const prefetcher &) = delete;
+  prefetcher &operator=(const prefetcher &) = delete;
+
+  // Queues listings of `directories`, to be served before anything queued earlier: the walk is
+  // depth-first, so the most recently discovered directories are the next ones it needs. Only a
+  // bounded number of jobs are held, waiting or done; past it the oldest waiting ones are
+  // dropped and the walk runs them itself.
+  void list_ahead(const path_list &directories) { queue(directories, job_kind::list); }
+
+  // Queues type probes of `paths`, to be served before anything queued earlier
+  void probe_ahead(const path_list &paths) { queue(paths, job_kind::probe); }
+
+  // Entries of `directory`, waiting for a queued listing or running it on this thread
+  bool list(const fs::path &directory, backend::entry_list &entries) {
+    auto job = take(directory, job_kind::list);
+    if (!job) {
+      return backend_.list(directory, entries);
+    }
+    // Workers list into the global heap, as the caller's resource need not be thread-safe
+    entries = std::move(job->entries);
+    return job->listed;
+  }
+
+  fs::file_type type(const fs::path &path) {
+    auto job = take(path, job_kind::probe);
+    return job ? job->type : backend_.type(path);
+  }
+
+private:
+  enum class job_kind { list, probe };
+
+  struct job {
+    job_kind kind;
+    fs::path path;
+    bool started = false;
+    bool done = false;
+    bool listed = false;
+    backend::entry_list entries;
+    fs::file_type type = fs::file_type::none;
+    std::exception_ptr error;
+  };
+
+  using job_key = std::pair<job_kind, fs::path>;
+
+  // Enough jobs to keep every worker busy while the walk catches up, without holding the listing
+  // of every directory of a wide tree in memory
+  static constexpr std::size_t JOBS_PER_WORKER = 64;
+
+  void queue(const path_list &paths, job_kind kind) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = paths.rbegin(); it != paths.rend(); ++it) {
+        auto key = job_key{kind, *it};
+        if (jobs_.count(key) == 0) {
+          auto queued = std::make_shared<job>();
+          queued->kind = kind;
+          queued->path = *it;
+          jobs_.emplace(std::move(key), queued);
+          pending_.push_front(std::move(queued));
+        }
+      }
+      while (jobs_.size() > max_jobs_ && !pending_.empty()) {
+        jobs_.erase(job_key{pending_.back()->kind, pending_.back()->path});
+        pending_.pop_back();
+      }
+    }
+    work_available_.notify_all();
+  }
+
+  static void run(const backend &fs_backend, job &j) {
+    try {
+      if (j.kind == job_kind::list) {
+        j.listed = fs_backend.list(j.path, j.entries);
+      } else {
+        j.type = fs_backend.type(j.path);
+      }
+    } catch (...) {
+      j.error = std::current_exception();
+    }
+  }
+
+  // Removes the job for `path` from the table; nullptr if none was queued
+  std::shared_ptr<job> take(const fs::path &path, job_kind kind) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = jobs_.find(job_key{kind, path});
+    if (it == jobs_.end()) {
+      return nullptr;
+    }
+    auto found = it->second;
+    jobs_.erase(it);
+    if (!found->started) {
+      // Not picked up by a worker yet: cheaper to run it here than to wait
+      found->started = true;
+      pending_.erase(std::find(pending_.begin(), pending_.end(), found));
+      lock.unlock();
+      run(backend_, *found);
+    } else {
+      job_done_.wait(lock, [&] { return found->done; });
+    }
+    if (found->error) {
+      std::rethrow_exception(found->error);
+    }
+    return found;
+  }
+
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_available_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      auto next = std::move(pending_.front());
+      pending_.pop_front();
+      next->started = true;
+      lock.unlock();
+      run(backend_, *next);
+      lock.lock();
+      next->done = true;
+      job_done_.notify_all();
+    }
+  }
+
+  const backend &backend_;
+  const std::size_t max_jobs_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable job_done_;
+  std::deque<std::shared_ptr<job>> pending_;
+  std::map<job_key, std::shared_ptr<job>> jobs_;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+// What is left of the budget of one bounded call. Once any limit is reached no more directories
+// are listed, but the entries already listed are still matched. Once the deadline passes or a
+// match has to be dropped, the walk stops altogether.
+class walk_budget {
+public:
+  explicit walk_budget(const budget &limits) : limits_(limits) {}
+
+  // The first limit reached
+  budget_status status() const { return status_; }
+
+  // Whether the walk should stop right away rather than finish the entries it holds
+  bool finished() const { return finished_; }
+
+  // Whether there is still time for more I/O
+  bool check_deadline() {
+    if (!finished_ && limits_.deadline != std::chrono::steady_clock::time_point::max() &&
+        std::chrono::steady_clock::now() >= limits_.deadline) {
+      exhaust(budget_status::deadline);
+      finished_ = true;
+    }
+    return !finished_;
+  }
+
+  // Charges one directory listing; false if it must not be done
+  bool charge_directory() {
+    if (!check_deadline() || status_ != budget_status::complete) {
+      return false;
+    }
+    if (directories_ == limits_.max_directories) {
+      exhaust(budget_status::directories);
+      return false;
+    }
+    ++directories_;
+    return true;
+  }
+
+  // Charges `count` listed entries
+  // \return how many of them may be examined
+  std::size_t charge_entries(std::size_t count) {
+    const auto left = limits_.max_entries - entries_;
+    if (count > left) {
+      exhaust(budget_status::entries);
+      count = left;
+    }
+    entries_ += count;
+    return count;
+  }
+
+  // Charges one result; false if it must be dropped
+  bool charge_result() {
+    // Only a match beyond the limit shows that the result is incomplete
+    if (results_ == limits_.max_results) {
+      exhaust(budget_status::results);
+      finished_ = true;
+      return false;
+    }
+    ++results_;
+    return true;
+  }
+
+private:
+  void exhaust(budget_status status) {
+    if (status_ == budget_status::complete) {
+      status_ = status;
+    }
+  }
+
+  const budget &limits_;
+  std::size_t directories_ = 0;
+  std::size_t entries_ = 0;
+  std::size_t results_ = 0;
+  budget_status status_ = budget_status::complete;
+  bool finished_ = false;
+};
+
+// State shared by every helper taking part in one glob call
+struct context {
+  cache *c = nullptr;
+  std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+  case_folding folding = case_folding::none;
+  const class backend *backend = &default_backend();
+  fs::path base_dir = {};
+  prefetcher *prefetch = nullptr;
+  const metadata_predicates *predicates = nullptr; // null when there are none to check
+  walk_budget *budget = nullptr;                   // null unless the call is bounded
+};
+
 #ifdef _WIN32
 #include <cstdlib>
 
@@ -185,195 +867,1337 @@ fs::path expand_tilde(fs::path path) {
   return path;
 }
 
-bool has_magic(const std::string &pathname) {
-  static const auto magic_check = std::regex("([*?[])");
-  return std::regex_search(pathname, magic_check);
+bool has_magic(std::string_view pathname) {
+  return pathname.find_first_of("*?[") != std::string_view::npos;
 }
 
 constexpr bool is_hidden(std::string_view pathname) noexcept { return pathname[0] == '.'; }
 
-constexpr bool is_recursive(std::string_view pattern) noexcept { return pattern == std::string_view{"**"}; }
-
-std::vector<fs::path> iter_directory(const fs::path &dirname, bool dironly) {
-  std::vector<fs::path> result;
+// Which entries of a listed directory wildcards skip. A name is hidden if the path reported for
+// it starts with '.': paths below an absolute directory never do, and relative ones only for
+// names directly in the starting directory or for directories that start with '.' themselves
+// (such as "../x").
+enum class hidden_names { none, all, dotted };
 
-  auto current_directory = dirname;
-  if (current_directory.empty()) {
-    current_directory = fs::current_path();
+hidden_names hidden_in(const fs::path &dirname) {
+  if (dirname.is_absolute()) {
+    return hidden_names::none;
   }
-
-  if (fs::exists(current_directory)) {
-    try {
-      for (auto &entry : fs::directory_iterator(
-              current_directory, fs::directory_options::follow_directory_symlink |
-                                      fs::directory_options::skip_permission_denied)) {
-        if (!dironly || entry.is_directory()) {
-          if (dirname.is_absolute()) {
-            result.push_back(entry.path());
-          } else {
-            result.push_back(fs::relative(entry.path()));
-          }
-        }
-      }
-    } catch (std::exception&) {
-      // not a directory
-      // do nothing
-    }
+  const auto normal = dirname.lexically_normal().string();
+  if (normal.empty() || normal == ".") {
+    return hidden_names::dotted;
   }
-
-  return result;
+  return is_hidden(normal) ? hidden_names::all : hidden_names::none;
 }
 
-// Recursively yields relative pathnames inside a literal directory.
-std::vector<fs::path> rlistdir(const fs::path &dirname, bool dironly) {
-  std::vector<fs::path> result;
-  auto names = iter_directory(dirname, dironly);
-  for (auto &&name : names) {
-    if (!is_hidden(name.string())) {
-      result.push_back(name);
-      auto matched_dirs = rlistdir(name, dironly);
-      std::copy(std::make_move_iterator(matched_dirs.begin()), std::make_move_iterator(matched_dirs.end()), std::back_inserter(result));
-    }
-  }
-  return result;
+bool is_hidden(hidden_names rule, std::string_view name) {
+  return rule == hidden_names::all || (rule == hidden_names::dotted && is_hidden(name));
 }
 
-// This helper function recursively yields relative pathnames inside a literal
-// directory.
-std::vector<fs::path> glob2(const fs::path &dirname, [[maybe_unused]] const fs::path &pattern,
-                            bool dironly) {
-  // std::cout << "In glob2\n";
-  std::vector<fs::path> result;
-  // look into the base directory as well, but only if it exists
-  if (fs::exists(dirname)) {
-    result.push_back(".");
+constexpr bool is_recursive(std::string_view pattern) noexcept { return pattern == std::string_view{"**"}; }
+
+// Where the backend finds `path`: relative paths are rooted at the base directory, if one was
+// given, instead of the process's current directory
+fs::path resolve(const context &ctx, const fs::path &path) {
+  if (ctx.base_dir.empty() || path.empty() || path.is_absolute()) {
+    return path;
   }
-  assert(is_recursive(pattern.string()));
-  auto matched_dirs = rlistdir(dirname, dironly);
-  std::copy(std::make_move_iterator(matched_dirs.begin()), std::make_move_iterator(matched_dirs.end()), std::back_inserter(result));
-  return result;
+  return ctx.base_dir / path;
 }
 
-// These 2 helper functions non-recursively glob inside a literal directory.
-// They return a list of basenames.  _glob1 accepts a pattern while _glob0
-// takes a literal basename (so it only has to check for its existence).
-
-std::vector<fs::path> glob1(const fs::path &dirname, const fs::path &pattern,
-                            bool dironly) {
-  // std::cout << "In glob1\n";
-  std::vector<fs::path> filtered_names;
-  auto names = iter_directory(dirname, dironly);
-  for (auto &&name : names) {
-    if (!is_hidden(name.string())) {
-      filtered_names.push_back(name.filename());
-      // if (name.is_relative()) {
-      //   // std::cout << "Filtered (Relative): " << name << "\n";
-      //   filtered_names.push_back(fs::relative(name));
-      // } else {
-      //   // std::cout << "Filtered (Absolute): " << name << "\n";
-      //   filtered_names.push_back(name.filename());
-      // }
-    }
+fs::file_type path_type(const context &ctx, const fs::path &path) {
+  if (ctx.budget && !ctx.budget->check_deadline()) {
+    return fs::file_type::not_found;
   }
-  return filter(filtered_names, pattern.string());
+  const auto resolved = resolve(ctx, path);
+  return ctx.prefetch ? ctx.prefetch->type(resolved) : ctx.backend->type(resolved);
 }
 
-std::vector<fs::path> glob0(const fs::path &dirname, const fs::path &basename,
-                            bool /*dironly*/) {
-  // std::cout << "In glob0\n";
-
-  // 'q*x/' should match only directories.
-  if ((basename.empty() && fs::is_directory(dirname)) || (!basename.empty() && fs::exists(dirname / basename))) {
-    return {basename};
-  }
-  return {};
+constexpr bool exists(fs::file_type type) noexcept {
+  return type != fs::file_type::not_found && type != fs::file_type::none;
 }
 
-std::vector<fs::path> glob(const fs::path &inpath, bool recursive = false,
-                           bool dironly = false) {
-  std::vector<fs::path> result;
+bool path_is_directory(const context &ctx, const fs::path &path) {
+  return path_type(ctx, path) == fs::file_type::directory;
+}
 
-  const auto pathname = inpath.string();
-  auto path = fs::path(pathname);
+// Whether `predicates` need more than the type of a candidate
+bool needs_metadata(const metadata_predicates &predicates) {
+  using time_point = metadata_predicates::time_point;
+  return predicates.min_size != 0 || predicates.max_size != std::numeric_limits<std::uintmax_t>::max() ||
+         predicates.min_mtime != time_point::min() || predicates.max_mtime != time_point::max() ||
+         predicates.min_ctime != time_point::min() || predicates.max_ctime != time_point::max() ||
+         predicates.predicate;
+}
 
-  if (pathname[0] == '~') {
-    // expand tilde
-    path = expand_tilde(path);
+// Whether the match `path` meets the metadata predicates, given the type its listing or probe
+// already reported (fs::file_type::unknown if none). Stats only if the predicates need more.
+bool accept(const context &ctx, const fs::path &path, fs::file_type known_type) {
+  if (!ctx.predicates) {
+    return true;
   }
+  const auto &predicates = *ctx.predicates;
+  file_metadata metadata;
+  metadata.type = known_type;
 
-  auto dirname = path.parent_path();
-  const auto basename = path.filename();
-
-  if (!has_magic(pathname)) {
-    assert(!dironly);
-
-    // Patterns ending with a slash should match only directories
-    if ((!basename.empty() && fs::exists(path)) || (basename.empty() && fs::is_directory(dirname))) {
-      result.push_back(path);
+  const bool type_known = known_type != fs::file_type::unknown && known_type != fs::file_type::symlink &&
+                          known_type != fs::file_type::none;
+  if (needs_metadata(predicates) || (predicates.type != fs::file_type::none && !type_known)) {
+    if ((ctx.budget && !ctx.budget->check_deadline()) || !ctx.backend->stat(resolve(ctx, path), metadata)) {
+      return false;
     }
-    return result;
   }
 
-  if (dirname.empty()) {
-    if (recursive && is_recursive(basename.string())) {
-      return glob2(dirname, basename, dironly);
-    }
-    return glob1(dirname, basename, dironly);
-  }
+  return (predicates.type == fs::file_type::none || metadata.type == predicates.type) &&
+         metadata.size >= predicates.min_size && metadata.size <= predicates.max_size &&
+         metadata.mtime >= predicates.min_mtime && metadata.mtime <= predicates.max_mtime &&
+         metadata.ctime >= predicates.min_ctime && metadata.ctime <= predicates.max_ctime &&
+         (!predicates.predicate || predicates.predicate(path, metadata));
+}
 
-  std::vector<fs::path> dirs{dirname};
-  if (dirname != fs::path(pathname) && has_magic(dirname.string())) {
-    dirs = glob(dirname, recursive, true);
+// The type of a listed entry, as far as the listing knows it
+fs::file_type listed_type(const backend::entry &entry) {
+  return entry.is_directory ? fs::file_type::directory : entry.type;
+}
+
+// The directory the backend has to list for `dirname`
+fs::path listing_path(const context &ctx, const fs::path &dirname) {
+  return dirname.empty() ? ctx.base_dir : resolve(ctx, dirname);
+}
+
+backend::entry_list list_entries(const fs::path &dirname, const context &ctx) {
+  backend::entry_list entries(ctx.resource);
+  if (ctx.budget && !ctx.budget->charge_directory()) {
+    return entries;
+  }
+  const auto directory = listing_path(ctx, dirname);
+
+  if (ctx.c) {
+    const auto current_directory = directory.empty() ? fs::current_path() : directory;
+    try {
+      if (auto listing = cache_access::listing(*ctx.c, current_directory)) {
+        for (auto &entry : listing->entries) {
+          entries.push_back({entry.filename, entry.is_directory});
+        }
+      }
+    } catch (std::exception&) {
+      // not a directory
+      // do nothing
+    }
+  } else if (ctx.prefetch) {
+    ctx.prefetch->list(directory, entries);
+  } else {
+    ctx.backend->list(directory, entries);
+  }
+
+  if (ctx.budget) {
+    entries.erase(entries.begin() + ctx.budget->charge_entries(entries.size()), entries.end());
+  }
+  return entries;
+}
+
+// Queues listings of `dirnames` ahead of the walk, if prefetching
+void list_ahead(const context &ctx, const path_list &dirnames) {
+  if (ctx.prefetch && dirnames.size() > 1) {
+    path_list directories(ctx.resource);
+    for (auto &dirname : dirnames) {
+      directories.push_back(listing_path(ctx, dirname));
+    }
+    ctx.prefetch->list_ahead(directories);
+  }
+}
+
+// Receives the matches of a plan step as they are found
+class match_sink {
+public:
+  virtual void add(fs::path &&match) = 0;
+
+  // The match `dirname` / `name`, for a listed `name` in a non-empty `dirname` already in the form
+  // matches take. Sinks that can store the two parts without joining them override this.
+  virtual void add(std::string_view dirname, std::string_view name) { add(fs::path(dirname) / name); }
+
+protected:
+  ~match_sink() = default;
+};
+
+// Collects matches into a vector: a path_list, or a plain std::vector for the overloads that
+// return one
+template <typename Paths> class list_sink final : public match_sink {
+public:
+  explicit list_sink(Paths &paths) : paths_(paths) {}
+
+  void add(fs::path &&match) override { paths_.push_back(std::move(match)); }
+
+private:
+  Paths &paths_;
+};
+
+// Stores matches compactly
+class compact_sink final : public match_sink {
+public:
+  explicit compact_sink(compact_paths &paths) : paths_(paths) {}
+
+  void add(fs::path &&match) override { paths_.push_back(match); }
+
+  void add(std::string_view dirname, std::string_view name) override { paths_.push_back(dirname, name); }
+
+private:
+  compact_paths &paths_;
+};
+
+// Keeps matches while the budget of a bounded call allows
+class budget_sink final : public match_sink {
+public:
+  budget_sink(walk_budget &budget, match_sink &out) : budget_(budget), out_(out) {}
+
+  void add(fs::path &&match) override {
+    if (budget_.charge_result()) {
+      out_.add(std::move(match));
+    }
+  }
+
+  void add(std::string_view dirname, std::string_view name) override {
+    if (budget_.charge_result()) {
+      out_.add(dirname, name);
+    }
+  }
+
+private:
+  walk_budget &budget_;
+  match_sink &out_;
+};
+
+// The form `dirname` takes in matches of the names listed in it: as it is if `normalize` is
+// false, else lexically normalized, with "." becoming empty as it vanishes from joined paths
+fs::path match_prefix(const fs::path &dirname, bool normalize) {
+  if (!normalize) {
+    return dirname;
+  }
+  auto prefix = dirname.lexically_normal();
+  return prefix == "." ? fs::path() : prefix;
+}
+
+// Passes the match `prefix` / `name` to `result`, without joining the two where the sink can
+// store them apart
+void add_listed(const fs::path &prefix, const fs::path &name, match_sink &result) {
+  if constexpr (std::is_same_v<fs::path::value_type, char>) {
+    if (!prefix.empty()) {
+      result.add(std::string_view(prefix.native()), std::string_view(name.native()));
+      return;
+    }
+  }
+  result.add(prefix / name);
+}
+
+// Recursively appends relative pathnames inside a literal directory to `result`, lexically
+// normalized if `normalize`. With `filter`, only pathnames meeting the metadata predicates are
+// appended, though the walk still descends into directories that do not.
+void rlistdir(const fs::path &dirname, bool dironly, bool normalize, bool filter, const context &ctx,
+              match_sink &result) {
+  const auto entries = list_entries(dirname, ctx);
+  const auto hidden = hidden_in(dirname);
+  const auto prefix = match_prefix(dirname, normalize);
+
+  if (ctx.prefetch) {
+    path_list subdirectories(ctx.resource);
+    for (auto &entry : entries) {
+      if (entry.is_directory && !is_hidden(hidden, entry.name.string())) {
+        subdirectories.push_back(listing_path(ctx, dirname / entry.name));
+      }
+    }
+    ctx.prefetch->list_ahead(subdirectories);
+  }
+
+  for (auto &entry : entries) {
+    if (ctx.budget && ctx.budget->finished()) {
+      return;
+    }
+    if ((!dironly || entry.is_directory) && !is_hidden(hidden, entry.name.string())) {
+      if (!filter) {
+        add_listed(prefix, entry.name, result);
+      } else if (auto match = prefix / entry.name; accept(ctx, match, listed_type(entry))) {
+        result.add(std::move(match));
+      }
+      // Only directories can have entries; skip the failed listing for everything else
+      if (entry.is_directory) {
+        rlistdir(dirname / entry.name, dironly, normalize, filter, ctx, result);
+      }
+    }
+  }
+}
+
+constexpr bool is_dot(std::string_view name) noexcept { return name == "." || name == ".."; }
+
+// Splits `pathname` into the literal directory the walk starts in and the steps run from there.
+//
+// Components are peeled off the end for as long as the remaining directory still has to be
+// resolved: while it has wildcards or, with case folding, ends in a name that has to be looked
+// up by listing. Consecutive literal names are then merged into a single probe.
+plan make_plan(const std::string &pathname, bool recursive, case_folding folding) {
+  plan result;
+  auto path = fs::path(pathname);
+
+  if (pathname[0] == '~') {
+    // expand tilde
+    path = expand_tilde(path);
+  }
+
+  const bool folds = folding != case_folding::none;
+  if (!folds && !has_magic(pathname)) {
+    // Patterns ending with a slash should match only directories
+    result.steps.push_back({plan::step_kind::literal, path.string(), plan::io_kind::probe});
+    return result;
+  }
+
+  std::vector<fs::path> segments;
+  for (;;) {
+    const auto dirname = path.parent_path();
+    const auto dirname_filename = dirname.filename().string();
+    segments.push_back(path.filename());
+    const bool resolve_dirname = has_magic(dirname.string()) ||
+                                 (folds && !dirname_filename.empty() && !is_dot(dirname_filename));
+    if (dirname.empty() || dirname == path || !resolve_dirname) {
+      result.start = dirname;
+      break;
+    }
+    path = dirname;
+  }
+  std::reverse(segments.begin(), segments.end());
+
+  // Whether the last step is a probe that another literal name can be appended to
+  bool extensible = false;
+  for (auto &component : segments) {
+    const auto segment = component.string();
+    if (segment.empty()) {
+      // 'q*x/' should match only directories, which a listing of directories only already did
+      if (extensible) {
+        result.steps.back().segment = (fs::path(result.steps.back().segment) / "").string();
+      } else {
+        const bool listed_directories = !result.steps.empty() &&
+                                        (result.steps.back().kind == plan::step_kind::wildcard ||
+                                         result.steps.back().kind == plan::step_kind::recursive);
+        result.steps.push_back({plan::step_kind::dironly, segment,
+                                listed_directories ? plan::io_kind::none : plan::io_kind::probe});
+      }
+      extensible = false;
+    } else if (recursive && is_recursive(segment)) {
+      result.steps.push_back({plan::step_kind::recursive, segment, plan::io_kind::walk});
+      extensible = false;
+    } else if (has_magic(segment)) {
+      result.steps.push_back({plan::step_kind::wildcard, segment, plan::io_kind::list});
+      extensible = false;
+    } else if (folds && !is_dot(segment)) {
+      // With case folding every spelling has to be found, so literals are listed too
+      result.steps.push_back({plan::step_kind::literal, segment, plan::io_kind::list});
+      extensible = false;
+    } else if (extensible && !is_dot(segment)) {
+      result.steps.back().segment = (fs::path(result.steps.back().segment) / segment).string();
+    } else {
+      result.steps.push_back({plan::step_kind::literal, segment, plan::io_kind::probe});
+      // "a/.." is resolved lexically between steps, so dot components are never merged
+      extensible = !is_dot(segment);
+    }
+  }
+  return result;
+}
+
+// A plan step ready to run: the step plus whatever its matching needs compiled
+struct compiled_step {
+  plan::step_kind kind;
+  plan::io_kind io;
+  fs::path segment;
+  bool dironly = false;                    // later steps can only match inside directories
+  std::shared_ptr<const std::regex> regex; // wildcard, without case folding
+  std::optional<wildcard> folded;          // wildcard, with case folding
+  std::string folded_literal;              // literal found by listing, with case folding
+};
+
+using step_list = std::pmr::vector<compiled_step>;
+
+step_list compile_plan(const plan &p, const context &ctx) {
+  step_list steps(ctx.resource);
+  for (std::size_t i = 0; i < p.steps.size(); ++i) {
+    const auto &s = p.steps[i];
+    compiled_step step{};
+    step.kind = s.kind;
+    step.io = s.io;
+    step.segment = s.segment;
+    step.dironly = i + 1 < p.steps.size();
+    if (s.kind == plan::step_kind::wildcard) {
+      if (ctx.folding != case_folding::none) {
+        step.folded.emplace(s.segment, ctx.folding);
+      } else {
+        step.regex = ctx.c ? cache_access::pattern(*ctx.c, s.segment)
+                           : std::make_shared<const std::regex>(compile_pattern(s.segment));
+      }
+    } else if (s.kind == plan::step_kind::literal && s.io == plan::io_kind::list) {
+      step.folded_literal = fold(s.segment, ctx.folding);
+    }
+    steps.push_back(std::move(step));
+  }
+  return steps;
+}
+
+// The path a probing step checks for in `dirname`
+fs::path probe_path(const fs::path &dirname, const compiled_step &step) {
+  return step.segment.empty() ? dirname : dirname / step.segment;
+}
+
+// Whether a case-folded literal is looked up by its exact spelling before its parent is listed:
+// directories on the way, so that the ancestors of an absolute pattern are not all listed from
+// "/" (which fails under execute-only directories). Other spellings of such a directory are only
+// found when the exact one does not exist.
+bool probes_first(const compiled_step &step) {
+  return step.kind == plan::step_kind::literal && step.io == plan::io_kind::list && step.dironly;
+}
+
+// Appends `name` found in `dirname` of type `type` (fs::file_type::unknown if not known yet):
+// names in the current directory as they are, anything else lexically normalized. Matches of the
+// last step are results and have to meet the metadata predicates.
+void add_match(const compiled_step &step, const fs::path &dirname, const fs::path &name, fs::file_type type,
+               const context &ctx, match_sink &result) {
+  auto match = dirname.empty() ? name : (dirname / name).lexically_normal();
+  if (step.dironly || accept(ctx, match, type)) {
+    result.add(std::move(match));
+  }
+}
+
+// add_match for `name` listed in the directory whose match_prefix is `prefix`
+void add_listed(const compiled_step &step, const fs::path &prefix, const fs::path &name, fs::file_type type,
+                const context &ctx, match_sink &result) {
+  if (step.dironly || !ctx.predicates) {
+    add_listed(prefix, name, result);
+  } else if (auto match = prefix / name; accept(ctx, match, type)) {
+    result.add(std::move(match));
+  }
+}
+
+void run_step(const compiled_step &step, const fs::path &dirname, const context &ctx,
+              match_sink &result) {
+  if (ctx.budget && ctx.budget->finished()) {
+    return;
+  }
+  switch (step.kind) {
+  case plan::step_kind::literal:
+    if (step.io == plan::io_kind::list) {
+      if (probes_first(step)) {
+        const auto type = path_type(ctx, probe_path(dirname, step));
+        if (type == fs::file_type::directory) {
+          add_match(step, dirname, step.segment, type, ctx, result);
+          break;
+        }
+      }
+      const auto prefix = match_prefix(dirname, !dirname.empty());
+      for (auto &entry : list_entries(dirname, ctx)) {
+        if (fold(entry.name.string(), ctx.folding) == step.folded_literal) {
+          add_listed(step, prefix, entry.name, listed_type(entry), ctx, result);
+        }
+      }
+    } else {
+      const auto type = path_type(ctx, probe_path(dirname, step));
+      const bool found = step.segment.filename().empty() ? type == fs::file_type::directory : exists(type);
+      if (found) {
+        add_match(step, dirname, step.segment, type, ctx, result);
+      }
+    }
+    break;
+
+  case plan::step_kind::wildcard: {
+    const auto hidden = hidden_in(dirname);
+    const auto prefix = match_prefix(dirname, !dirname.empty());
+    for (auto &entry : list_entries(dirname, ctx)) {
+      if ((!step.dironly || entry.is_directory) && !is_hidden(hidden, entry.name.string()) &&
+          (step.folded ? step.folded->match(entry.name.string()) : fnmatch(entry.name, *step.regex))) {
+        add_listed(step, prefix, entry.name, listed_type(entry), ctx, result);
+      }
+    }
+    break;
+  }
+
+  case plan::step_kind::recursive: {
+    // look into the base directory as well, but only if it exists
+    const auto type = path_type(ctx, dirname);
+    if (exists(type)) {
+      add_match(step, dirname, ".", type, ctx, result);
+    }
+    rlistdir(dirname, step.dironly, !dirname.empty(), !step.dironly && ctx.predicates, ctx, result);
+    break;
+  }
+
+  case plan::step_kind::dironly:
+    if (step.io == plan::io_kind::none || path_is_directory(ctx, dirname)) {
+      add_match(step, dirname, step.segment, fs::file_type::directory, ctx, result);
+    }
+    break;
+  }
+}
+
+// Queues the I/O `step` will do for each of `dirnames`, if prefetching
+void prefetch_step(const compiled_step &step, const path_list &dirnames, const context &ctx) {
+  if (!ctx.prefetch || dirnames.size() < 2 || step.io == plan::io_kind::none) {
+    return;
+  }
+  if (step.io == plan::io_kind::probe || probes_first(step)) {
+    path_list probes(ctx.resource);
+    for (auto &d : dirnames) {
+      probes.push_back(resolve(ctx, probe_path(d, step)));
+    }
+    ctx.prefetch->probe_ahead(probes);
+  } else {
+    list_ahead(ctx, dirnames);
+  }
+}
+
+void run_steps_from(const step_list &steps, std::size_t i, const fs::path &dirname,
+                    const context &ctx, match_sink &out);
+
+// Passes each match of a step straight on to the steps after it
+class step_sink final : public match_sink {
+public:
+  step_sink(const step_list &steps, std::size_t next, const context &ctx, match_sink &out)
+      : steps_(steps), next_(next), ctx_(ctx), out_(out) {}
+
+  void add(fs::path &&match) override { run_steps_from(steps_, next_, match, ctx_, out_); }
+
+private:
+  const step_list &steps_;
+  const std::size_t next_;
+  const context &ctx_;
+  match_sink &out_;
+};
+
+// Runs the steps of a plan from step `i` on over `dirname` depth first: every match of a step is
+// run through the remaining steps as soon as it is found
+void run_steps_from(const step_list &steps, std::size_t i, const fs::path &dirname,
+                    const context &ctx, match_sink &out) {
+  if (i + 1 == steps.size()) {
+    run_step(steps[i], dirname, ctx, out);
+  } else {
+    step_sink next(steps, i + 1, ctx, out);
+    run_step(steps[i], dirname, ctx, next);
+  }
+}
+
+// Runs the steps of `p` left to right, each over every path the previous one produced. The
+// matches of the last step go to `out`.
+void run_plan(const plan &p, const context &ctx, match_sink &out) {
+  const auto steps = compile_plan(p, ctx);
+  if (ctx.budget) {
+    // Whatever is found before the budget runs out has to be a result, e.g. the files of the
+    // first directories of "/**/*" rather than nothing because "**" never finished
+    if (!steps.empty()) {
+      run_steps_from(steps, 0, p.start, ctx, out);
+    }
+    return;
+  }
+  path_list paths({p.start}, ctx.resource);
+  for (std::size_t i = 0; i < steps.size(); ++i) {
+    prefetch_step(steps[i], paths, ctx);
+    if (i + 1 == steps.size()) {
+      for (auto &d : paths) {
+        run_step(steps[i], d, ctx, out);
+      }
+      break;
+    }
+    path_list next(ctx.resource);
+    list_sink next_sink(next);
+    for (auto &d : paths) {
+      run_step(steps[i], d, ctx, next_sink);
+    }
+    paths = std::move(next);
+  }
+}
+
+// Runs the internal glob against a pathname, passing the matches to `out`
+void glob(const std::string &pathname, bool recursive, const context &ctx, match_sink &out) {
+  run_plan(make_plan(pathname, recursive, ctx.folding), ctx, out);
+}
+
+// Runs the internal glob against each pathname, passing the matches to `out`
+void glob(const std::vector<std::string> &pathnames, bool recursive, const context &ctx, match_sink &out) {
+  for (const auto &pathname : pathnames) {
+    glob(pathname, recursive, ctx, out);
+  }
+}
+
+// The matches of one pathname or several, allocated from the context's resource
+template <typename Pathnames>
+path_list glob(const Pathnames &pathnames, bool recursive, const context &ctx) {
+  path_list result(ctx.resource);
+  list_sink out(result);
+  glob(pathnames, recursive, ctx, out);
+  return result;
+}
+
+// The matches of one pathname or several, in a plain vector
+template <typename Pathnames>
+std::vector<fs::path> glob_vector(const Pathnames &pathnames, bool recursive, const context &ctx) {
+  std::vector<fs::path> result;
+  list_sink out(result);
+  glob(pathnames, recursive, ctx, out);
+  return result;
+}
+
+// Walks a plan depth first, listing every directory in sorted order, and keeps the first
+// `count` matches after a resume position.
+//
+// Each match is identified by the keys chosen on the way to it: the name of the match of each
+// step and, under `**`, the name of each directory level followed by "" for the directory
+// itself. Matches are reached in lexicographic order of their keys, so a walk resumed from the
+// keys of the last match skips every choice before them without listing what lies below it.
+class page_walk {
+public:
+  page_walk(const context &ctx, const plan &p, std::size_t count, std::vector<std::string> resume)
+      : ctx_(ctx), steps_(compile_plan(p, ctx)), count_(count), resume_(std::move(resume)), last_(resume_) {}
+
+  // Runs the walk from `start`
+  // \return true if there are matches after the last one kept
+  bool run(const fs::path &start) { return visit(0, start); }
+
+  std::vector<fs::path> matches;
+
+  // The keys of the last match kept, or of the resume position if none was
+  const std::vector<std::string> &last() const { return last_; }
+
+private:
+  // Runs step `i` over `path`; a match of the last step is a result
+  bool visit(std::size_t i, const fs::path &path) {
+    if (i == steps_.size()) {
+      return emit(path);
+    }
+    const auto &step = steps_[i];
+    if (step.kind == plan::step_kind::recursive) {
+      return walk_tree(step, i, path);
+    }
+
+    path_list found(ctx_.resource);
+    list_sink out(found);
+    run_step(step, path, ctx_, out);
+    std::pmr::vector<std::pair<std::string, fs::path>> children(ctx_.resource);
+    for (auto &match : found) {
+      children.emplace_back(match.filename().string(), std::move(match));
+    }
+    std::sort(children.begin(), children.end());
+    for (auto &[key, match] : children) {
+      if (child(key, [&] { return visit(i + 1, match); })) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The recursive step over `dirname`: the directory itself, then everything below it
+  bool walk_tree(const compiled_step &step, std::size_t i, const fs::path &dirname) {
+    const bool stop = child("", [&] {
+      const auto type = path_type(ctx_, dirname);
+      path_list self(ctx_.resource);
+      list_sink out(self);
+      if (exists(type)) {
+        add_match(step, dirname, ".", type, ctx_, out);
+      }
+      return !self.empty() && visit(i + 1, self.front());
+    });
+    return stop || walk_directory(step, i, dirname, !dirname.empty());
+  }
+
+  // Mirrors rlistdir, one directory level per key
+  bool walk_directory(const compiled_step &step, std::size_t i, const fs::path &dirname, bool normalize) {
+    auto entries = list_entries(dirname, ctx_);
+    std::sort(entries.begin(), entries.end(),
+              [](const backend::entry &a, const backend::entry &b) { return a.name < b.name; });
+
+    const auto hidden = hidden_in(dirname);
+
+    if (ctx_.prefetch) {
+      // Subdirectories before the resume position were emitted by earlier pages
+      const auto *from = resume_key();
+      path_list subdirectories(ctx_.resource);
+      for (auto &entry : entries) {
+        if (entry.is_directory && !is_hidden(hidden, entry.name.string()) &&
+            (!from || entry.name.string() >= *from)) {
+          subdirectories.push_back(listing_path(ctx_, dirname / entry.name));
+        }
+      }
+      ctx_.prefetch->list_ahead(subdirectories);
+    }
+
+    const bool filter = !step.dironly && ctx_.predicates;
+    for (auto &entry : entries) {
+      const auto key = entry.name.string();
+      if ((step.dironly && !entry.is_directory) || is_hidden(hidden, key)) {
+        continue;
+      }
+      const bool stop = child(key, [&] {
+        const auto name = dirname / entry.name;
+        const bool stop = child("", [&] {
+          const auto match = normalize ? name.lexically_normal() : name;
+          return (!filter || accept(ctx_, match, listed_type(entry))) && visit(i + 1, match);
+        });
+        return stop || (entry.is_directory && walk_directory(step, i, name, normalize));
+      });
+      if (stop) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The key of the resume position at the current depth, if the walk is still on the way to it
+  const std::string *resume_key() const {
+    return matched_ == keys_.size() && matched_ < resume_.size() ? &resume_[matched_] : nullptr;
+  }
+
+  // Visits the choice `key` of the current position with `f` unless it comes before the resume
+  // position; children have to be tried in ascending order of their keys
+  template <typename Visit> bool child(const std::string &key, Visit &&f) {
+    const auto *from = resume_key();
+    if (from && key < *from) {
+      return false;
+    }
+    keys_.push_back(key);
+    if (from && key == *from) {
+      ++matched_;
+    }
+    const bool stop = f();
+    keys_.pop_back();
+    matched_ = std::min(matched_, keys_.size());
+    return stop;
+  }
+
+  bool emit(const fs::path &match) {
+    if (matched_ == keys_.size()) {
+      // the resume position itself, or a match above it
+      return false;
+    }
+    if (matches.size() == count_) {
+      return true;
+    }
+    matches.push_back(match);
+    last_ = keys_;
+    return false;
+  }
+
+  const context &ctx_;
+  const step_list steps_;
+  const std::size_t count_;
+  const std::vector<std::string> resume_;
+  std::vector<std::string> last_;
+  std::vector<std::string> keys_;
+  std::size_t matched_ = 0; // leading keys equal to the resume position's
+};
+
+context make_context(const options &opts) {
+  context ctx;
+  if (opts.backend) {
+    ctx.backend = opts.backend;
+  }
+  ctx.base_dir = opts.base_dir;
+  if (opts.predicates.type != fs::file_type::none || needs_metadata(opts.predicates)) {
+    ctx.predicates = &opts.predicates;
+  }
+  if (opts.case_insensitive) {
+    ctx.folding = opts.unicode_case_folding ? case_folding::unicode : case_folding::ascii;
+  }
+  return ctx;
+}
+
+// Runs `run` with the context described by `opts`, including its prefetching pool if any
+template <typename Glob>
+auto with_options(const options &opts, Glob &&run) {
+  auto ctx = make_context(opts);
+  std::optional<prefetcher> prefetch;
+  if (opts.io_concurrency > 1) {
+    prefetch.emplace(*ctx.backend, opts.io_concurrency);
+    ctx.prefetch = &*prefetch;
+  }
+  return run(ctx);
+}
+
+// Runs `run` with the context described by `opts`, answering listings from `c`. Listings come
+// from the cache before any prefetching worker could serve them, so none are started.
+template <typename Glob>
+auto with_cache(cache &c, const options &opts, Glob &&run) {
+  if (opts.backend && !dynamic_cast<const disk_backend *>(opts.backend)) {
+    throw std::invalid_argument("glob: a cache only holds listings of the real filesystem");
+  }
+  auto ctx = make_context(opts);
+  ctx.c = &c;
+  return run(ctx);
+}
+
+// Splits a '/'-separated path into its components, dropping empty and "." components
+void split_components(std::string_view path, std::vector<std::string_view> &components) {
+  components.clear();
+  std::size_t start = 0;
+  while (start <= path.size()) {
+    auto end = path.find('/', start);
+    if (end == std::string_view::npos) {
+      end = path.size();
+    }
+    const auto component = path.substr(start, end - start);
+    if (!component.empty() && component != ".") {
+      components.push_back(component);
+    }
+    start = end + 1;
+  }
+}
+
+// A compiled `pattern_set` is stored as one blob: a header followed by four tables, each at an
+// 8-byte aligned offset: patterns, segments (path components), tokens and character sets. The
+// same blob is matched against directly whether it was just compiled, deserialized or mapped
+// from a file. Bump BLOB_VERSION whenever the layout or the meaning of a field changes.
+
+constexpr char BLOB_MAGIC[8] = {'G', 'L', 'O', 'B', 'P', 'S', 'E', 'T'};
+constexpr std::uint32_t BLOB_VERSION = 1;
+constexpr std::uint32_t BLOB_BYTE_ORDER = 0x01020304;
+
+struct blob_header {
+  char magic[8];
+  std::uint32_t byte_order;
+  std::uint32_t version;
+  std::uint32_t folding;
+  std::uint32_t pattern_count;
+  std::uint32_t segment_count;
+  std::uint32_t token_count;
+  std::uint32_t set_count;
+  std::uint32_t reserved;
+};
+
+struct pattern_record {
+  std::uint32_t first_segment;
+  std::uint32_t segment_count;
+  std::uint32_t min_components;
+  std::uint8_t absolute;
+  std::uint8_t dironly;
+  std::uint8_t has_recursive;
+  std::uint8_t unused;
+};
+
+struct segment_record {
+  std::uint32_t first_token;
+  std::uint32_t token_count;
+  std::uint8_t recursive;
+  std::uint8_t literal;
+  std::uint8_t unused[2];
+};
+
+static_assert(sizeof(blob_header) == 40 && std::is_trivially_copyable_v<blob_header>);
+static_assert(sizeof(pattern_record) == 16 && std::is_trivially_copyable_v<pattern_record>);
+static_assert(sizeof(segment_record) == 12 && std::is_trivially_copyable_v<segment_record>);
+
+constexpr std::size_t align8(std::size_t n) { return (n + 7) & ~std::size_t{7}; }
+
+struct blob_layout {
+  std::size_t patterns, segments, tokens, sets, size;
+
+  explicit blob_layout(const blob_header &header)
+      : patterns(align8(sizeof(blob_header))),
+        segments(align8(patterns + header.pattern_count * sizeof(pattern_record))),
+        tokens(align8(segments + header.segment_count * sizeof(segment_record))),
+        sets(align8(tokens + header.token_count * sizeof(token))),
+        size(sets + header.set_count * sizeof(charset)) {}
+};
+
+template <typename T>
+void append_table(std::vector<unsigned char> &blob, std::size_t offset, const std::vector<T> &table) {
+  if (!table.empty()) {
+    std::memcpy(blob.data() + offset, table.data(), table.size() * sizeof(T));
+  }
+}
+
+std::vector<unsigned char> compile_pattern_set(const std::vector<std::string> &patterns,
+                                               bool recursive, case_folding folding) {
+  std::vector<pattern_record> pattern_records;
+  std::vector<segment_record> segments;
+  std::vector<token> tokens;
+  std::vector<charset> sets;
+  std::vector<std::string_view> components;
+
+  for (const auto &pattern : patterns) {
+    pattern_record record{};
+    record.first_segment = static_cast<std::uint32_t>(segments.size());
+    record.absolute = !pattern.empty() && pattern[0] == '/';
+    record.dironly = !pattern.empty() && pattern.back() == '/';
+    split_components(pattern, components);
+    for (auto component : components) {
+      const auto first_token = static_cast<std::uint32_t>(tokens.size());
+      if (recursive && is_recursive(component)) {
+        record.has_recursive = 1;
+        // consecutive '**' are equivalent to one
+        if (record.segment_count > 0 && segments.back().recursive) {
+          continue;
+        }
+        segments.push_back({first_token, 0, 1, 0, {}});
+      } else {
+        compile_wildcard(component, folding, tokens, sets);
+        segments.push_back({first_token, static_cast<std::uint32_t>(tokens.size()) - first_token, 0,
+                            !has_magic(component), {}});
+        ++record.min_components;
+      }
+      ++record.segment_count;
+    }
+    pattern_records.push_back(record);
+  }
+
+  blob_header header{};
+  std::memcpy(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+  header.byte_order = BLOB_BYTE_ORDER;
+  header.version = BLOB_VERSION;
+  header.folding = static_cast<std::uint32_t>(folding);
+  header.pattern_count = static_cast<std::uint32_t>(pattern_records.size());
+  header.segment_count = static_cast<std::uint32_t>(segments.size());
+  header.token_count = static_cast<std::uint32_t>(tokens.size());
+  header.set_count = static_cast<std::uint32_t>(sets.size());
+
+  const blob_layout layout(header);
+  std::vector<unsigned char> blob(layout.size);
+  std::memcpy(blob.data(), &header, sizeof(header));
+  append_table(blob, layout.patterns, pattern_records);
+  append_table(blob, layout.segments, segments);
+  append_table(blob, layout.tokens, tokens);
+  append_table(blob, layout.sets, sets);
+  return blob;
+}
+
+// The tables of a validated blob
+struct pattern_tables {
+  case_folding folding;
+  const pattern_record *patterns;
+  std::size_t pattern_count;
+  const segment_record *segments;
+  const token *tokens;
+  const charset *sets;
+};
+
+// Checks every count and index so that matching never reads outside the blob
+pattern_tables attach_pattern_set(const unsigned char *data, std::size_t size) {
+  const auto fail = [](const char *reason) {
+    throw std::invalid_argument(std::string{"error: invalid pattern set: "} + reason);
+  };
+
+  blob_header header;
+  if (size < sizeof(header)) {
+    fail("truncated header");
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0) {
+    fail("bad magic");
+  }
+  if (header.byte_order != BLOB_BYTE_ORDER) {
+    fail("written on a machine with a different byte order");
+  }
+  if (header.version != BLOB_VERSION) {
+    fail("unsupported version");
+  }
+  if (header.folding > static_cast<std::uint32_t>(case_folding::unicode)) {
+    fail("unknown case folding");
+  }
+  if (reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t) != 0) {
+    fail("data is not 8-byte aligned");
+  }
+  const blob_layout layout(header);
+  if (layout.size != size) {
+    fail("size does not match header");
+  }
+
+  pattern_tables tables{static_cast<case_folding>(header.folding),
+                        reinterpret_cast<const pattern_record *>(data + layout.patterns),
+                        header.pattern_count,
+                        reinterpret_cast<const segment_record *>(data + layout.segments),
+                        reinterpret_cast<const token *>(data + layout.tokens),
+                        reinterpret_cast<const charset *>(data + layout.sets)};
+
+  for (std::size_t i = 0; i < header.pattern_count; ++i) {
+    const auto &pattern = tables.patterns[i];
+    if (std::uint64_t{pattern.first_segment} + pattern.segment_count > header.segment_count) {
+      fail("segment index out of range");
+    }
+  }
+  for (std::size_t i = 0; i < header.segment_count; ++i) {
+    const auto &segment = tables.segments[i];
+    if (std::uint64_t{segment.first_token} + segment.token_count > header.token_count) {
+      fail("token index out of range");
+    }
+  }
+  for (std::size_t i = 0; i < header.token_count; ++i) {
+    const auto &t = tables.tokens[i];
+    if (t.kind > token_kind::set || (t.kind == token_kind::set && t.set_index >= header.set_count)) {
+      fail("bad token");
+    }
+  }
+  return tables;
+}
+
+bool match_pattern(const pattern_tables &tables, const pattern_record &pattern, std::string_view path,
+                   const std::vector<std::string_view> &components, std::vector<char> &reach) {
+  const bool absolute = !path.empty() && path[0] == '/';
+  const bool directory = !path.empty() && path.back() == '/';
+  const auto n = components.size();
+  if (absolute != static_cast<bool>(pattern.absolute) || (pattern.dironly && !directory) ||
+      n < pattern.min_components || (!pattern.has_recursive && n != pattern.min_components)) {
+    return false;
+  }
+
+  // reach[j]: the segments seen so far match the first j components
+  reach.assign(n + 1, 0);
+  reach[0] = 1;
+  for (std::size_t k = 0; k < pattern.segment_count; ++k) {
+    const auto &segment = tables.segments[pattern.first_segment + k];
+    if (segment.recursive) {
+      for (std::size_t j = 1; j <= n; ++j) {
+        reach[j] = reach[j] || (reach[j - 1] && !is_hidden(components[j - 1]));
+      }
+      continue;
+    }
+    bool any = false;
+    for (std::size_t j = n; j > 0; --j) {
+      reach[j] = reach[j - 1] && (segment.literal || !is_hidden(components[j - 1])) &&
+                 match_tokens(tables.tokens + segment.first_token, segment.token_count, tables.sets,
+                              tables.folding, components[j - 1]);
+      any = any || reach[j];
+    }
+    reach[0] = 0;
+    if (!any) {
+      return false;
+    }
+  }
+  return reach[n];
+}
+
+} // namespace end
+
+bool disk_backend::list(const fs::path &dirname, entry_list &entries) const {
+  std::error_code ec;
+  fs::directory_iterator it(dirname.empty() ? fs::path(".") : dirname,
+                            fs::directory_options::follow_directory_symlink |
+                                fs::directory_options::skip_permission_denied,
+                            ec);
+  for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    // Both answered from d_type where the platform provides it; only symlinks need a stat
+    std::error_code type_ec;
+    const bool is_directory = it->is_directory(type_ec);
+    const bool is_regular = !is_directory && it->is_regular_file(type_ec);
+    entries.push_back({it->path().filename(), is_directory,
+                       is_directory ? fs::file_type::directory
+                                    : (is_regular ? fs::file_type::regular : fs::file_type::unknown)});
+  }
+  return !ec;
+}
+
+fs::file_type disk_backend::type(const fs::path &path) const {
+  std::error_code ec;
+  const auto type = fs::status(path, ec).type();
+  return type == fs::file_type::none ? fs::file_type::not_found : type;
+}
+
+namespace {
+
+#ifndef _WIN32
+fs::file_type file_type_of(mode_t mode) {
+  if (S_ISREG(mode)) return fs::file_type::regular;
+  if (S_ISDIR(mode)) return fs::file_type::directory;
+  if (S_ISLNK(mode)) return fs::file_type::symlink;
+  if (S_ISCHR(mode)) return fs::file_type::character;
+  if (S_ISBLK(mode)) return fs::file_type::block;
+  if (S_ISFIFO(mode)) return fs::file_type::fifo;
+  if (S_ISSOCK(mode)) return fs::file_type::socket;
+  return fs::file_type::unknown;
+}
+
+std::chrono::system_clock::time_point to_time_point(const timespec &time) {
+  return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+      std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec)));
+}
+#else
+std::chrono::system_clock::time_point to_time_point(fs::file_time_type time) {
+  return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+      time - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+}
+#endif
+
+} // namespace
+
+bool disk_backend::stat(const fs::path &path, file_metadata &metadata) const {
+#ifndef _WIN32
+  struct ::stat st;
+  if (::stat(path.empty() ? "." : path.c_str(), &st) != 0) {
+    return false;
+  }
+  metadata.type = file_type_of(st.st_mode);
+  metadata.size = static_cast<std::uintmax_t>(st.st_size);
+#ifdef __APPLE__
+  metadata.mtime = to_time_point(st.st_mtimespec);
+  metadata.ctime = to_time_point(st.st_ctimespec);
+#else
+  metadata.mtime = to_time_point(st.st_mtim);
+  metadata.ctime = to_time_point(st.st_ctim);
+#endif
+  return true;
+#else
+  // No status change time through std::filesystem; the modification time stands in for it
+  std::error_code ec;
+  const auto status = fs::status(path, ec);
+  if (ec || !fs::exists(status)) {
+    return false;
   }
+  metadata.type = status.type();
+  metadata.size = fs::is_regular_file(status) ? fs::file_size(path, ec) : 0;
+  metadata.mtime = metadata.ctime = to_time_point(fs::last_write_time(path, ec));
+  return !ec;
+#endif
+}
 
-  auto glob_in_dir = glob0;
-  if (has_magic(basename.string())) {
-    if (recursive && is_recursive(basename.string())) {
-      glob_in_dir = glob2;
-    } else {
-      glob_in_dir = glob1;
+bool backend::stat(const fs::path &path, file_metadata &metadata) const {
+  metadata.type = type(path);
+  return metadata.type != fs::file_type::not_found;
+}
+
+namespace {
+
+// Trees are keyed by normalized generic paths without trailing separator; "." is the current
+// directory
+std::string memory_key(const fs::path &path) {
+  auto key = path.lexically_normal().generic_string();
+  while (key.size() > 1 && key.back() == '/') {
+    key.pop_back();
+  }
+  return key.empty() ? std::string{"."} : key;
+}
+
+} // namespace
+
+void memory_backend::add_file(const fs::path &path, std::uintmax_t size,
+                              std::chrono::system_clock::time_point mtime) {
+  add(path, {fs::file_type::regular, size, mtime, mtime});
+}
+
+void memory_backend::add_directory(const fs::path &path) { add(path, {fs::file_type::directory}); }
+
+void memory_backend::add(const fs::path &path, const file_metadata &metadata) {
+  const auto key = memory_key(path);
+  if (!nodes_.emplace(key, metadata).second) {
+    return;
+  }
+  if (key == "." || key == "/") {
+    return;
+  }
+  const auto parent = memory_key(fs::path(key).parent_path());
+  add(parent, {fs::file_type::directory});
+  children_[parent].push_back(
+      {fs::path(key).filename(), metadata.type == fs::file_type::directory, metadata.type});
+}
+
+bool memory_backend::list(const fs::path &dirname, entry_list &entries) const {
+  const auto key = memory_key(dirname);
+  if (type(key) != fs::file_type::directory) {
+    return false;
+  }
+  auto it = children_.find(key);
+  if (it != children_.end()) {
+    entries.insert(entries.end(), it->second.begin(), it->second.end());
+  }
+  return true;
+}
+
+fs::file_type memory_backend::type(const fs::path &path) const {
+  if (path.empty()) {
+    return fs::file_type::not_found;
+  }
+  auto it = nodes_.find(memory_key(path));
+  return it == nodes_.end() ? fs::file_type::not_found : it->second.type;
+}
+
+bool memory_backend::stat(const fs::path &path, file_metadata &metadata) const {
+  if (path.empty()) {
+    return false;
+  }
+  auto it = nodes_.find(memory_key(path));
+  if (it == nodes_.end()) {
+    return false;
+  }
+  metadata = it->second;
+  return true;
+}
+
+struct pattern_set::impl {
+  std::vector<unsigned char> storage; // owns the blob, unless it lives in caller-provided memory
+  void *mapping = nullptr;            // owns the blob, if mapped by `map_file`
+  std::size_t mapping_size = 0;
+  const unsigned char *blob = nullptr;
+  std::size_t blob_size = 0;
+  pattern_tables tables{};
+
+  impl() = default;
+  impl(const impl &) = delete;
+  impl &operator=(const impl &) = delete;
+
+  ~impl() {
+#ifndef _WIN32
+    if (mapping) {
+      ::munmap(mapping, mapping_size);
     }
+#endif
+  }
+
+  void attach(const void *data, std::size_t size) {
+    tables = attach_pattern_set(static_cast<const unsigned char *>(data), size);
+    blob = static_cast<const unsigned char *>(data);
+    blob_size = size;
+  }
+
+  // `components` and `reach` are scratch buffers reused across calls by one thread
+  bool match(std::string_view path, std::vector<std::string_view> &components,
+             std::vector<char> &reach) const {
+    split_components(path, components);
+    for (std::size_t i = 0; i < tables.pattern_count; ++i) {
+      if (match_pattern(tables, tables.patterns[i], path, components, reach)) {
+        return true;
+      }
+    }
+    return false;
   }
 
-  for (auto &d : dirs) {
-    for (auto &&name : glob_in_dir(d, basename, dironly)) {
-      fs::path subresult = name;
-      if (name.parent_path().empty()) {
-        subresult = d / name;
+  template <typename Paths>
+  std::vector<std::size_t> filter(const Paths &paths, std::size_t count, unsigned threads) const {
+    // Large enough to amortize scheduling, small enough to balance uneven batches
+    static constexpr std::size_t BATCH_SIZE = 4096;
+
+    const auto batches = (count + BATCH_SIZE - 1) / BATCH_SIZE;
+    std::vector<std::vector<std::size_t>> matched(batches);
+    std::atomic<std::size_t> next_batch{0};
+
+    const auto worker = [&] {
+      std::vector<std::string_view> components;
+      std::vector<char> reach;
+      for (auto batch = next_batch++; batch < batches; batch = next_batch++) {
+        const auto end = std::min(count, (batch + 1) * BATCH_SIZE);
+        for (auto i = batch * BATCH_SIZE; i < end; ++i) {
+          if (match(std::string_view(paths[i]), components, reach)) {
+            matched[batch].push_back(i);
+          }
+        }
       }
-      result.push_back(subresult.lexically_normal());
+    };
+
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, batches));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+      thread.join();
+    }
+
+    std::vector<std::size_t> result;
+    for (auto &batch : matched) {
+      result.insert(result.end(), batch.begin(), batch.end());
     }
+    return result;
   }
+};
+
+pattern_set::pattern_set() : impl_(std::make_unique<impl>()) {}
+
+pattern_set::pattern_set(const std::vector<std::string> &patterns, bool recursive,
+                         const options &opts)
+    : impl_(std::make_unique<impl>()) {
+  impl_->storage = compile_pattern_set(patterns, recursive, make_context(opts).folding);
+  impl_->attach(impl_->storage.data(), impl_->storage.size());
+}
+
+std::vector<unsigned char> pattern_set::serialize() const {
+  return std::vector<unsigned char>(impl_->blob, impl_->blob + impl_->blob_size);
+}
 
+pattern_set pattern_set::deserialize(const void *data, std::size_t size) {
+  pattern_set result;
+  result.impl_->attach(data, size);
   return result;
 }
 
-} // namespace end
+pattern_set pattern_set::map_file(const fs::path &path) {
+  pattern_set result;
+#ifdef _WIN32
+  // No shared mapping here; read the blob into memory instead
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path.string());
+  }
+  result.impl_->storage.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  result.impl_->attach(result.impl_->storage.data(), result.impl_->storage.size());
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), path.string());
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    const int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path.string());
+  }
+  const auto size = static_cast<std::size_t>(st.st_size);
+  void *mapping = size == 0 ? MAP_FAILED : ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  const int error = errno;
+  ::close(fd);
+  if (size == 0) {
+    attach_pattern_set(nullptr, 0); // throws: truncated header
+  }
+  if (mapping == MAP_FAILED) {
+    throw std::system_error(error, std::generic_category(), path.string());
+  }
+  result.impl_->mapping = mapping;
+  result.impl_->mapping_size = size;
+  result.impl_->attach(mapping, size);
+#endif
+  return result;
+}
+
+pattern_set::~pattern_set() = default;
+
+pattern_set::pattern_set(pattern_set &&) noexcept = default;
+
+pattern_set &pattern_set::operator=(pattern_set &&) noexcept = default;
+
+bool pattern_set::match(std::string_view path) const {
+  std::vector<std::string_view> components;
+  std::vector<char> reach;
+  return impl_->match(path, components, reach);
+}
+
+std::vector<std::size_t> pattern_set::filter(const std::string_view *paths, std::size_t count,
+                                             unsigned threads) const {
+  return impl_->filter(paths, count, threads);
+}
+
+std::vector<std::size_t> pattern_set::filter(const std::vector<std::string_view> &paths,
+                                             unsigned threads) const {
+  return impl_->filter(paths.data(), paths.size(), threads);
+}
+
+std::vector<std::size_t> pattern_set::filter(const std::vector<std::string> &paths,
+                                             unsigned threads) const {
+  return impl_->filter(paths, paths.size(), threads);
+}
 
 std::vector<fs::path> glob(const std::string &pathname) {
-  return glob(pathname, false);
+  return glob_vector(pathname, false, context{});
 }
 
 std::vector<fs::path> rglob(const std::string &pathname) {
-  return glob(pathname, true);
+  return glob_vector(pathname, true, context{});
 }
 
 std::vector<fs::path> glob(const std::vector<std::string> &pathnames) {
-  std::vector<fs::path> result;
-  for (const auto &pathname : pathnames) {
-    auto matched_res = glob(pathname, false);
-    std::copy(std::make_move_iterator(matched_res.begin()), std::make_move_iterator(matched_res.end()), std::back_inserter(result));
-  }
-  return result;
+  return glob_vector(pathnames, false, context{});
 }
 
 std::vector<fs::path> rglob(const std::vector<std::string> &pathnames) {
-  std::vector<fs::path> result;
-  for (const auto &pathname : pathnames) {
-    auto matched_res = glob(pathname, true);
-    std::copy(std::make_move_iterator(matched_res.begin()), std::make_move_iterator(matched_res.end()), std::back_inserter(result));
-  }
-  return result;
+  return glob_vector(pathnames, true, context{});
 }
 
 std::vector<fs::path>
@@ -386,4 +2210,490 @@ rglob(const std::initializer_list<std::string> &pathnames) {
   return rglob(std::vector<std::string>(pathnames));
 }
 
+std::vector<fs::path> glob(const std::string &pathname, cache &c) {
+  return glob_vector(pathname, false, context{&c});
+}
+
+std::vector<fs::path> rglob(const std::string &pathname, cache &c) {
+  return glob_vector(pathname, true, context{&c});
+}
+
+std::vector<fs::path> glob(const std::vector<std::string> &pathnames, cache &c) {
+  return glob_vector(pathnames, false, context{&c});
+}
+
+std::vector<fs::path> rglob(const std::vector<std::string> &pathnames, cache &c) {
+  return glob_vector(pathnames, true, context{&c});
+}
+
+std::pmr::vector<fs::path> glob(const std::string &pathname, std::pmr::memory_resource *resource) {
+  return glob(pathname, false, context{nullptr, resource});
+}
+
+std::pmr::vector<fs::path> rglob(const std::string &pathname, std::pmr::memory_resource *resource) {
+  return glob(pathname, true, context{nullptr, resource});
+}
+
+std::pmr::vector<fs::path> glob(const std::vector<std::string> &pathnames,
+                                std::pmr::memory_resource *resource) {
+  return glob(pathnames, false, context{nullptr, resource});
+}
+
+std::pmr::vector<fs::path> rglob(const std::vector<std::string> &pathnames,
+                                 std::pmr::memory_resource *resource) {
+  return glob(pathnames, true, context{nullptr, resource});
+}
+
+std::vector<fs::path> glob(const std::string &pathname, const options &opts) {
+  return with_options(opts, [&](const context &ctx) { return glob_vector(pathname, false, ctx); });
+}
+
+std::vector<fs::path> rglob(const std::string &pathname, const options &opts) {
+  return with_options(opts, [&](const context &ctx) { return glob_vector(pathname, true, ctx); });
+}
+
+std::vector<fs::path> glob(const std::vector<std::string> &pathnames, const options &opts) {
+  return with_options(opts, [&](const context &ctx) { return glob_vector(pathnames, false, ctx); });
+}
+
+std::vector<fs::path> rglob(const std::vector<std::string> &pathnames, const options &opts) {
+  return with_options(opts, [&](const context &ctx) { return glob_vector(pathnames, true, ctx); });
+}
+
+std::vector<fs::path> glob(const std::string &pathname, cache &c, const options &opts) {
+  return with_cache(c, opts, [&](const context &ctx) { return glob_vector(pathname, false, ctx); });
+}
+
+std::vector<fs::path> rglob(const std::string &pathname, cache &c, const options &opts) {
+  return with_cache(c, opts, [&](const context &ctx) { return glob_vector(pathname, true, ctx); });
+}
+
+std::vector<fs::path> glob(const std::vector<std::string> &pathnames, cache &c, const options &opts) {
+  return with_cache(c, opts, [&](const context &ctx) { return glob_vector(pathnames, false, ctx); });
+}
+
+std::vector<fs::path> rglob(const std::vector<std::string> &pathnames, cache &c, const options &opts) {
+  return with_cache(c, opts, [&](const context &ctx) { return glob_vector(pathnames, true, ctx); });
+}
+
+bounded_result glob_bounded(const std::string &pathname, const budget &limits, const options &opts) {
+  return glob_bounded(std::vector<std::string>{pathname}, limits, opts);
+}
+
+bounded_result rglob_bounded(const std::string &pathname, const budget &limits, const options &opts) {
+  return rglob_bounded(std::vector<std::string>{pathname}, limits, opts);
+}
+
+namespace {
+
+bounded_result run_bounded(const std::vector<std::string> &pathnames, bool recursive, const budget &limits,
+                           const options &opts) {
+  auto sequential = opts;
+  sequential.io_concurrency = 1;
+  return with_options(sequential, [&](const context &ctx) {
+    walk_budget remaining(limits);
+    auto bounded = ctx;
+    bounded.budget = &remaining;
+    std::vector<fs::path> matches;
+    list_sink list(matches);
+    budget_sink out(remaining, list);
+    glob(pathnames, recursive, bounded, out);
+    return bounded_result{std::move(matches), remaining.status()};
+  });
+}
+
+} // namespace
+
+bounded_result glob_bounded(const std::vector<std::string> &pathnames, const budget &limits, const options &opts) {
+  return run_bounded(pathnames, false, limits, opts);
+}
+
+bounded_result rglob_bounded(const std::vector<std::string> &pathnames, const budget &limits, const options &opts) {
+  return run_bounded(pathnames, true, limits, opts);
+}
+
+compact_paths glob_compact(const std::string &pathname, const options &opts) {
+  return glob_compact(std::vector<std::string>{pathname}, opts);
+}
+
+compact_paths rglob_compact(const std::string &pathname, const options &opts) {
+  return rglob_compact(std::vector<std::string>{pathname}, opts);
+}
+
+compact_paths glob_compact(const std::vector<std::string> &pathnames, const options &opts) {
+  return with_options(opts, [&](const context &ctx) {
+    compact_paths result;
+    compact_sink out(result);
+    glob(pathnames, false, ctx, out);
+    return result;
+  });
+}
+
+compact_paths rglob_compact(const std::vector<std::string> &pathnames, const options &opts) {
+  return with_options(opts, [&](const context &ctx) {
+    compact_paths result;
+    compact_sink out(result);
+    glob(pathnames, true, ctx, out);
+    return result;
+  });
+}
+
+namespace {
+
+void put_varint(std::vector<unsigned char> &out, std::size_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<unsigned char>(value));
+}
+
+std::size_t get_varint(const std::vector<unsigned char> &in, std::size_t &offset) {
+  std::size_t value = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    if (offset == in.size() || shift >= std::numeric_limits<std::size_t>::digits) {
+      throw std::invalid_argument("glob: truncated varint");
+    }
+    const auto byte = in[offset++];
+    value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+constexpr char compact_separator = static_cast<char>(fs::path::preferred_separator);
+
+} // namespace
+
+// A record is the directory (0 if the same as the previous record's, otherwise its id + 1,
+// where id 0 is "no directory"), the length of the prefix shared with the previous name, the
+// length of the rest of the name and the rest of the name.
+void compact_paths::push_back(std::string_view path) {
+  // "a/b" is stored as "a" and "b"; "/a" and "b" as they are
+  std::size_t directory = 0;
+  auto name = path;
+  const auto pos = path.rfind(compact_separator);
+  if (pos != std::string_view::npos && pos > 0) {
+    const auto dirname = path.substr(0, pos);
+    name = path.substr(pos + 1);
+    if (last_directory_ != 0 && directory_name(last_directory_) == dirname) {
+      directory = last_directory_;
+    } else {
+      directory = directory_id(dirname);
+    }
+  }
+  append(directory, name);
+}
+
+void compact_paths::push_back(std::string_view dirname, std::string_view name) {
+  // push_back(path) would split these elsewhere, e.g. "/a" as no directory and "/a"
+  if (dirname.empty() || dirname.back() == compact_separator ||
+      name.find(compact_separator) != std::string_view::npos) {
+    push_back((fs::path(dirname) / name).string());
+    return;
+  }
+  const bool same_directory = last_directory_ != 0 && directory_name(last_directory_) == dirname;
+  append(same_directory ? last_directory_ : directory_id(dirname), name);
+}
+
+void compact_paths::append(std::size_t directory, std::string_view name) {
+  put_varint(records_, directory == last_directory_ ? 0 : directory + 1);
+  std::size_t shared = 0;
+  while (shared < name.size() && shared < last_name_.size() && name[shared] == last_name_[shared]) {
+    ++shared;
+  }
+  put_varint(records_, shared);
+  put_varint(records_, name.size() - shared);
+  records_.insert(records_.end(), name.begin() + shared, name.end());
+
+  last_name_.assign(name);
+  last_directory_ = directory;
+  ++size_;
+}
+
+void compact_paths::push_back(const fs::path &path) {
+  if constexpr (std::is_same_v<fs::path::value_type, char>) {
+    push_back(std::string_view(path.native()));
+  } else {
+    push_back(std::string_view(path.string()));
+  }
+}
+
+std::vector<fs::path> compact_paths::to_paths() const {
+  std::vector<fs::path> paths;
+  paths.reserve(size_);
+  for (auto it = begin(); it != end(); ++it) {
+    paths.push_back(it.path());
+  }
+  return paths;
+}
+
+std::size_t compact_paths::memory_usage() const noexcept {
+  std::size_t bytes = directories_.capacity() + directory_ends_.capacity() * sizeof(std::size_t) +
+                      records_.capacity() + last_name_.capacity();
+  return bytes + directory_slots_.capacity() * sizeof(std::size_t);
+}
+
+compact_paths::const_iterator::const_iterator(const compact_paths *paths, std::size_t offset)
+    : paths_(paths), offset_(offset), next_(offset) {
+  decode();
+}
+
+// Reads the record at `offset_` into the current match
+void compact_paths::const_iterator::decode() {
+  const auto &records = paths_->records_;
+  if (offset_ == records.size()) {
+    return;
+  }
+  next_ = offset_;
+  const auto code = get_varint(records, next_);
+  if (code != 0) {
+    directory_ = code - 1;
+  }
+  const auto shared = get_varint(records, next_);
+  const auto length = get_varint(records, next_);
+  name_.resize(shared);
+  name_.append(reinterpret_cast<const char *>(records.data() + next_), length);
+  next_ += length;
+
+  path_.assign(directory());
+  if (directory_ != 0) {
+    path_ += compact_separator;
+  }
+  path_ += name_;
+}
+
+compact_paths::const_iterator &compact_paths::const_iterator::operator++() {
+  offset_ = next_;
+  decode();
+  return *this;
+}
+
+compact_paths::const_iterator compact_paths::const_iterator::operator++(int) {
+  auto previous = *this;
+  ++*this;
+  return previous;
+}
+
+std::string_view compact_paths::const_iterator::directory() const {
+  return paths_->directory_name(directory_);
+}
+
+// The table only holds ids and hashes the directory names they refer to in `directories_`, so
+// each directory is stored once. It is kept at most half full.
+std::size_t compact_paths::directory_id(std::string_view dirname) {
+  const std::hash<std::string_view> hash;
+  if ((directory_ends_.size() + 1) * 2 > directory_slots_.size()) {
+    std::vector<std::size_t> slots(std::max<std::size_t>(16, directory_slots_.size() * 2), 0);
+    const auto mask = slots.size() - 1;
+    for (std::size_t id = 1; id <= directory_ends_.size(); ++id) {
+      auto slot = hash(directory_name(id)) & mask;
+      while (slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+      }
+      slots[slot] = id;
+    }
+    directory_slots_.swap(slots);
+  }
+
+  const auto mask = directory_slots_.size() - 1;
+  for (auto slot = hash(dirname) & mask;; slot = (slot + 1) & mask) {
+    const auto id = directory_slots_[slot];
+    if (id == 0) {
+      directories_.append(dirname);
+      directory_ends_.push_back(directories_.size());
+      directory_slots_[slot] = directory_ends_.size();
+      return directory_ends_.size();
+    }
+    if (directory_name(id) == dirname) {
+      return id;
+    }
+  }
+}
+
+std::string_view compact_paths::directory_name(std::size_t id) const {
+  if (id == 0) {
+    return {};
+  }
+  const auto first = id == 1 ? 0 : directory_ends_[id - 2];
+  return std::string_view(directories_).substr(first, directory_ends_[id - 1] - first);
+}
+
+namespace {
+
+// A resume token is the hex-encoded fingerprint of the query (pattern, matching options and base
+// directory), then the number of keys and each
+// key as its length and bytes
+std::uint64_t page_fingerprint(const std::string &pathname, bool recursive, const options &opts) {
+  std::uint64_t hash = 14695981039346656037ull;
+  const auto mix = [&](unsigned char byte) {
+    hash ^= byte;
+    hash *= 1099511628211ull;
+  };
+  mix(static_cast<unsigned char>(recursive | opts.case_insensitive << 1 | opts.unicode_case_folding << 2));
+  for (auto c : pathname) {
+    mix(static_cast<unsigned char>(c));
+  }
+  // Relative patterns resume at positions under the base directory
+  mix(0);
+  for (auto c : opts.base_dir.string()) {
+    mix(static_cast<unsigned char>(c));
+  }
+  return hash;
+}
+
+std::string encode_resume_token(std::uint64_t fingerprint, const std::vector<std::string> &keys) {
+  std::vector<unsigned char> bytes;
+  for (int i = 0; i < 8; ++i) {
+    bytes.push_back(static_cast<unsigned char>(fingerprint >> (8 * i)));
+  }
+  put_varint(bytes, keys.size());
+  for (auto &key : keys) {
+    put_varint(bytes, key.size());
+    bytes.insert(bytes.end(), key.begin(), key.end());
+  }
+
+  static constexpr char DIGITS[] = "0123456789abcdef";
+  std::string token;
+  for (auto byte : bytes) {
+    token += DIGITS[byte >> 4];
+    token += DIGITS[byte & 0xf];
+  }
+  return token;
+}
+
+std::vector<std::string> decode_resume_token(std::uint64_t fingerprint, const std::string &token) {
+  const auto invalid = [] { return std::invalid_argument("glob: invalid resume token"); };
+  const auto digit = [&](char c) -> unsigned {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    throw invalid();
+  };
+  if (token.size() % 2 != 0 || token.size() < 18) {
+    throw invalid();
+  }
+  std::vector<unsigned char> bytes;
+  for (std::size_t i = 0; i < token.size(); i += 2) {
+    bytes.push_back(static_cast<unsigned char>(digit(token[i]) << 4 | digit(token[i + 1])));
+  }
+
+  std::uint64_t stored = 0;
+  for (int i = 0; i < 8; ++i) {
+    stored |= std::uint64_t{bytes[i]} << (8 * i);
+  }
+  if (stored != fingerprint) {
+    throw std::invalid_argument("glob: resume token belongs to another query");
+  }
+
+  std::size_t offset = 8;
+  const auto count = get_varint(bytes, offset);
+  if (count > bytes.size()) {
+    throw invalid();
+  }
+  std::vector<std::string> keys(count);
+  for (auto &key : keys) {
+    const auto size = get_varint(bytes, offset);
+    if (size > bytes.size() - offset) {
+      throw invalid();
+    }
+    key.assign(reinterpret_cast<const char *>(bytes.data() + offset), size);
+    offset += size;
+  }
+  if (offset != bytes.size() || keys.empty()) {
+    throw invalid();
+  }
+  return keys;
+}
+
+page run_page(const std::string &pathname, bool recursive, std::size_t count, const std::string &resume_token,
+              const options &opts) {
+  if (count == 0) {
+    throw std::invalid_argument("glob: a page holds at least one match");
+  }
+  const auto fingerprint = page_fingerprint(pathname, recursive, opts);
+  auto resume = resume_token.empty() ? std::vector<std::string>{} : decode_resume_token(fingerprint, resume_token);
+  return with_options(opts, [&](const context &ctx) {
+    const auto p = make_plan(pathname, recursive, ctx.folding);
+    page_walk walk(ctx, p, count, std::move(resume));
+    page result;
+    if (walk.run(p.start)) {
+      result.resume_token = encode_resume_token(fingerprint, walk.last());
+    }
+    result.matches = std::move(walk.matches);
+    return result;
+  });
+}
+
+} // namespace
+
+page glob_page(const std::string &pathname, std::size_t count, const std::string &resume_token,
+               const options &opts) {
+  return run_page(pathname, false, count, resume_token, opts);
+}
+
+page rglob_page(const std::string &pathname, std::size_t count, const std::string &resume_token,
+                const options &opts) {
+  return run_page(pathname, true, count, resume_token, opts);
+}
+
+std::string plan::str() const {
+  static constexpr const char *KIND_NAMES[] = {"literal", "wildcard", "recursive", "dironly"};
+  std::ostringstream out;
+  out << "start: ";
+  if (start.empty()) {
+    out << "current directory\n";
+  } else {
+    out << start << "\n";
+  }
+  for (std::size_t i = 0; i < steps.size(); ++i) {
+    const auto &s = steps[i];
+    out << i + 1 << ". " << KIND_NAMES[static_cast<int>(s.kind)];
+    if (!s.segment.empty()) {
+      out << " \"" << s.segment << '"';
+    }
+    out << ": ";
+    switch (s.io) {
+    case io_kind::none:
+      out << "no I/O";
+      break;
+    case io_kind::probe:
+      out << "1 probe";
+      break;
+    case io_kind::list:
+      out << "1 listing";
+      break;
+    case io_kind::walk:
+      out << "1 listing per directory below";
+      break;
+    }
+    if (s.io != io_kind::none && i > 0) {
+      out << (s.io == io_kind::walk ? " each" : " per") << " path from step " << i;
+    } else if (s.io == io_kind::walk) {
+      out << " the start";
+    }
+    out << "\n";
+  }
+  return out.str();
+}
+
+plan explain(const std::string &pathname, bool recursive, const options &opts) {
+  return make_plan(pathname, recursive, make_context(opts).folding);
+}
+
+namespace detail {
+
+bool match_name(std::string_view name, std::string_view pattern, match_engine engine, const options &opts) {
+  const auto folding = make_context(opts).folding;
+  if (engine == match_engine::native) {
+    return wildcard(pattern, folding).match(name);
+  }
+  if (folding != case_folding::none) {
+    throw std::invalid_argument("glob::detail::match_name: the regex engine does not fold case");
+  }
+  return std::regex_match(name.begin(), name.end(), compile_pattern(pattern));
+}
+
+} // namespace detail
+
 } // namespace glob
@@ -0,0 +1,26 @@
+#pragma once
+
+// Internal: the name matchers behind glob, exposed to the tests that check them against each
+// other. Not part of the installed headers.
+
+#include <glob/glob.h>
+
+#include <string_view>
+
+namespace glob::detail {
+
+/// The implementations a name can be matched against a wildcard with
+enum class match_engine {
+  regex,  ///< translated to a std::regex; used by case-sensitive `glob` and `rglob`
+  native, ///< compiled to tokens matched in O(pattern * name) time; used by case-insensitive
+          ///< globbing and `pattern_set`
+};
+
+/// Whether the path component `name` matches the shell-style wildcard `pattern` as `glob` would
+/// match it (except that names starting with '.' are not skipped), using `engine`. Honors the
+/// case folding of `opts`, which the regex engine does not support (std::invalid_argument).
+/// Every call compiles `pattern`.
+bool match_name(std::string_view name, std::string_view pattern, match_engine engine = match_engine::native,
+                const options &opts = {});
+
+} // namespace glob::detail
@@ -1,6 +1,8 @@
 #include <glob/glob.h>
 #include <glob/version.h>
 
+#include "server.h"
+
 #include <cxxopts.hpp>
 #include <iostream>
 #include <string>
@@ -9,7 +11,11 @@ int main(int argc, char** argv) {
   cxxopts::Options options(argv[0], "Run glob to find all the pathnames matching a specified pattern");
 
   bool recursive;
+  bool filter;
+  bool explain;
   std::vector<std::string> patterns;
+  std::string serve_socket;
+  std::string connect_socket;
 
   // clang-format off
   options.add_options()
@@ -17,6 +23,10 @@ int main(int argc, char** argv) {
     ("v,version", "Print the current version number")
     ("r,recursive", "Run glob recursively", cxxopts::value<bool>(recursive)->default_value("false"))
     ("i,input", "Patterns to match", cxxopts::value<std::vector<std::string>>(patterns))
+    ("f,filter", "Match patterns against paths read from standard input", cxxopts::value<bool>(filter)->default_value("false"))
+    ("explain", "Print how each pattern would be executed instead of running it", cxxopts::value<bool>(explain)->default_value("false"))
+    ("serve", "Run as a daemon answering patterns on a Unix socket", cxxopts::value<std::string>(serve_socket))
+    ("connect", "Send patterns to a daemon listening on a Unix socket", cxxopts::value<std::string>(connect_socket))
   ;
   // clang-format on
 
@@ -30,11 +40,38 @@ int main(int argc, char** argv) {
     return 0;
   }
 
+  if (!serve_socket.empty()) {
+    glob::cache cache;
+    return serve(serve_socket, cache);
+  }
+
   if (patterns.empty()) {
     std::cout << options.help() << std::endl;
     return 0;
   }
 
+  if (explain) {
+    for (auto& pattern: patterns) {
+      std::cout << pattern << "\n" << glob::explain(pattern, recursive).str();
+    }
+    return 0;
+  }
+
+  if (filter) {
+    std::vector<std::string> paths;
+    for (std::string line; std::getline(std::cin, line);) {
+      paths.push_back(std::move(line));
+    }
+    for (auto index : glob::pattern_set(patterns, recursive).filter(paths)) {
+      std::cout << glob::fs::path(paths[index]) << "\n";
+    }
+    return 0;
+  }
+
+  if (!connect_socket.empty()) {
+    return query(connect_socket, patterns, recursive, std::cout);
+  }
+
   if (recursive) {
     for (auto& match: glob::rglob(patterns)) {
      std::cout << match << "\n";
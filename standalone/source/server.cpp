@@ -0,0 +1,222 @@
+#include "server.h"
+
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+int serve(const std::string & /*socket_path*/, glob::cache & /*cache*/) {
+  std::cerr << "error: --serve is not supported on this platform" << std::endl;
+  return 1;
+}
+
+int query(const std::string & /*socket_path*/, const std::vector<std::string> & /*patterns*/,
+          bool /*recursive*/, std::ostream & /*out*/) {
+  std::cerr << "error: --connect is not supported on this platform" << std::endl;
+  return 1;
+}
+
+#else
+
+namespace {
+
+class connection {
+public:
+  explicit connection(int fd) : fd_(fd) {}
+  ~connection() { ::close(fd_); }
+  connection(const connection &) = delete;
+  connection &operator=(const connection &) = delete;
+
+  // Reads up to (and strips) the next NUL; false on EOF or error
+  bool read_record(std::string &record) {
+    record.clear();
+    while (true) {
+      auto end = buffer_.find('\0', offset_);
+      if (end != std::string::npos) {
+        record.assign(buffer_, offset_, end - offset_);
+        offset_ = end + 1;
+        return true;
+      }
+      buffer_.erase(0, offset_);
+      offset_ = 0;
+      char chunk[4096];
+      auto n = ::read(fd_, chunk, sizeof(chunk));
+      if (n <= 0) {
+        return false;
+      }
+      buffer_.append(chunk, static_cast<std::size_t>(n));
+    }
+  }
+
+  bool write_all(const std::string &data) {
+    std::size_t written = 0;
+    while (written < data.size()) {
+      auto n = ::write(fd_, data.data() + written, data.size() - written);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      written += static_cast<std::size_t>(n);
+    }
+    return true;
+  }
+
+private:
+  int fd_;
+  std::string buffer_;
+  std::size_t offset_ = 0;
+};
+
+bool make_address(const std::string &socket_path, sockaddr_un &address) {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "error: socket path too long: " << socket_path << std::endl;
+    return false;
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  return true;
+}
+
+// Appends the record `tag` `payload` to `out`
+void append_record(std::string &out, char tag, const std::string &payload) {
+  out += tag;
+  out += payload;
+  out += '\0';
+}
+
+void handle_client(int fd, glob::cache &cache) {
+  connection client(fd);
+  glob::options opts;
+  std::string record;
+  while (client.read_record(record)) {
+    if (record.empty()) {
+      if (!client.write_all(std::string(1, '\0'))) {
+        return;
+      }
+      continue;
+    }
+    const char tag = record[0];
+    auto payload = record.substr(1);
+    if (tag == 'd') {
+      opts.base_dir = std::move(payload);
+      continue;
+    }
+    if (tag != 'g' && tag != 'r') {
+      std::cerr << "warning: ignoring malformed request record: " << record << std::endl;
+      continue;
+    }
+    std::string response;
+    try {
+      const auto matches = tag == 'r' ? glob::rglob(payload, cache, opts) : glob::glob(payload, cache, opts);
+      for (auto &match : matches) {
+        append_record(response, 'm', match.string());
+      }
+    } catch (std::exception &e) {
+      append_record(response, 'e', payload + ": " + e.what());
+    }
+    if (!client.write_all(response)) {
+      return;
+    }
+  }
+}
+
+} // namespace
+
+int serve(const std::string &socket_path, glob::cache &cache) {
+  sockaddr_un address;
+  if (!make_address(socket_path, address)) {
+    return 1;
+  }
+
+  // A client hanging up mid-response must not take the server down
+  std::signal(SIGPIPE, SIG_IGN);
+
+  int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    std::perror("socket");
+    return 1;
+  }
+  ::unlink(socket_path.c_str());
+  if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+      ::listen(listener, SOMAXCONN) < 0) {
+    std::perror(socket_path.c_str());
+    ::close(listener);
+    return 1;
+  }
+
+  while (true) {
+    int fd = ::accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::perror("accept");
+      break;
+    }
+    std::thread(handle_client, fd, std::ref(cache)).detach();
+  }
+
+  ::close(listener);
+  ::unlink(socket_path.c_str());
+  return 1;
+}
+
+int query(const std::string &socket_path, const std::vector<std::string> &patterns,
+          bool recursive, std::ostream &out) {
+  sockaddr_un address;
+  if (!make_address(socket_path, address)) {
+    return 1;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    std::perror("socket");
+    return 1;
+  }
+  connection server(fd);
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    std::perror(socket_path.c_str());
+    return 1;
+  }
+
+  std::string request;
+  append_record(request, 'd', glob::fs::current_path().string());
+  for (auto &pattern : patterns) {
+    append_record(request, recursive ? 'r' : 'g', pattern);
+  }
+  request += '\0';
+  if (!server.write_all(request)) {
+    std::perror(socket_path.c_str());
+    return 1;
+  }
+
+  int status = 0;
+  std::string record;
+  while (server.read_record(record)) {
+    if (record.empty()) {
+      return status;
+    }
+    if (record[0] == 'm') {
+      out << glob::fs::path(record.substr(1)) << "\n";
+    } else if (record[0] == 'e') {
+      std::cerr << "error: " << record.substr(1) << std::endl;
+      status = 1;
+    }
+  }
+  std::cerr << "error: connection to " << socket_path << " closed unexpectedly" << std::endl;
+  return 1;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <glob/glob.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Record-based protocol spoken over a Unix domain stream socket. Every record is a tag byte
+// followed by a payload and a terminating NUL; paths cannot contain NUL, so names with newlines
+// or any other bytes pass through unchanged.
+//
+// A request is a batch of records terminated by an empty record:
+//   `d<directory>`  roots relative patterns of the rest of the connection at `directory`
+//                   (the client's current directory) instead of the server's
+//   `g<pattern>`    glob
+//   `r<pattern>`    rglob
+// The server answers each pattern in order, as soon as it has been expanded, with one record
+// `m<path>` per match, or a single record `e<message>` if the pattern could not be expanded,
+// and ends the batch with an empty record. A connection may carry any number of batches.
+
+/// Listens on `socket_path` and answers batches from `cache` until the process is killed
+/// \return process exit code
+int serve(const std::string &socket_path, glob::cache &cache);
+
+/// Sends `patterns` as one batch to the server at `socket_path`, rooted at the current
+/// directory, and writes the matches to `out`. Patterns the server failed to expand are
+/// reported on std::cerr.
+/// \return process exit code
+int query(const std::string &socket_path, const std::vector<std::string> &patterns,
+          bool recursive, std::ostream &out);
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+glob::memory_backend make_tree() {
+  glob::memory_backend tree;
+  tree.add_file("src/main.cpp");
+  tree.add_file("src/util/strings.cpp");
+  tree.add_file("src/util/strings.h");
+  tree.add_file("src/.cache/tmp.cpp");
+  tree.add_directory("docs");
+  tree.add_file("/archive/README.md");
+  return tree;
+}
+
+} // namespace
+
+TEST(backendTest, MemoryTree) {
+  const auto tree = make_tree();
+  glob::options opts;
+  opts.backend = &tree;
+
+  EXPECT_EQ(sorted(glob::glob("*", opts)), (std::vector<std::string>{"docs", "src"}));
+  EXPECT_EQ(sorted(glob::glob("src/*/*.h", opts)), (std::vector<std::string>{"src/util/strings.h"}));
+  // Only names directly in the starting directory are hidden
+  EXPECT_EQ(sorted(glob::rglob("src/**/*.cpp", opts)),
+            (std::vector<std::string>{"src/.cache/tmp.cpp", "src/main.cpp", "src/util/strings.cpp"}));
+  EXPECT_EQ(sorted(glob::glob("src/.cache/tmp.cpp", opts)), (std::vector<std::string>{"src/.cache/tmp.cpp"}));
+  EXPECT_EQ(sorted(glob::glob("*/", opts)), (std::vector<std::string>{"docs/", "src/"}));
+  EXPECT_EQ(sorted(glob::glob("/archive/*.md", opts)), (std::vector<std::string>{"/archive/README.md"}));
+  EXPECT_TRUE(glob::glob("src/main.cpp/*", opts).empty());
+  EXPECT_TRUE(glob::glob("missing/*", opts).empty());
+}
+
+TEST(backendTest, CaseInsensitiveMemoryTree) {
+  const auto tree = make_tree();
+  glob::options opts;
+  opts.backend = &tree;
+  opts.case_insensitive = true;
+
+  EXPECT_EQ(sorted(glob::glob("SRC/Util/STRINGS.*", opts)),
+            (std::vector<std::string>{"src/util/strings.cpp", "src/util/strings.h"}));
+}
+
+TEST(backendTest, PrefetchingPreservesResults) {
+  glob::memory_backend tree;
+  for (int a = 0; a < 6; ++a) {
+    for (int b = 0; b < 6; ++b) {
+      const auto dir = "d" + std::to_string(a) + "/e" + std::to_string(b);
+      tree.add_file(dir + "/Makefile");
+      tree.add_file(dir + "/f.txt");
+    }
+  }
+  // More subdirectories than the prefetcher holds jobs for, so some are dropped from its queue
+  for (int w = 0; w < 1000; ++w) {
+    tree.add_file("wide/w" + std::to_string(w) + "/f.txt");
+  }
+
+  for (auto pattern : {"**/*.txt", "*/*/Makefile", "d[0-3]/*/*", "**", "wide/*/*.txt"}) {
+    counting_backend sequential_backend(tree), prefetching_backend(tree);
+    glob::options sequential, prefetching;
+    sequential.backend = &sequential_backend;
+    prefetching.backend = &prefetching_backend;
+    prefetching.io_concurrency = 2;
+
+    const auto expected = glob::rglob(pattern, sequential);
+    EXPECT_FALSE(expected.empty()) << pattern;
+    EXPECT_EQ(glob::rglob(pattern, prefetching), expected) << pattern;
+    // Work done ahead is work the walk would have done anyway
+    EXPECT_EQ(prefetching_backend.lists, sequential_backend.lists) << pattern;
+    EXPECT_EQ(prefetching_backend.probes, sequential_backend.probes) << pattern;
+  }
+}
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// 10 directories of 10 subdirectories of 10 files each
+glob::memory_backend make_tree() {
+  glob::memory_backend tree;
+  for (int a = 0; a < 10; ++a) {
+    for (int b = 0; b < 10; ++b) {
+      for (int f = 0; f < 10; ++f) {
+        tree.add_file("d" + std::to_string(a) + "/s" + std::to_string(b) + "/f" + std::to_string(f));
+      }
+    }
+  }
+  return tree;
+}
+
+} // namespace
+
+TEST(budgetTest, UnlimitedIsComplete) {
+  const auto tree = make_tree();
+  glob::options opts;
+  opts.backend = &tree;
+
+  const auto result = glob::rglob_bounded("**/f1", {}, opts);
+  EXPECT_EQ(result.status, glob::budget_status::complete);
+  EXPECT_EQ(sorted(result.matches), sorted(glob::rglob("**/f1", opts)));
+
+  const std::vector<std::string> patterns = {"d1/*/f1", "d2/s2/*"};
+  const auto many = glob::glob_bounded(patterns, {}, opts);
+  EXPECT_EQ(many.status, glob::budget_status::complete);
+  EXPECT_EQ(sorted(many.matches), sorted(glob::glob(patterns, opts)));
+}
+
+TEST(budgetTest, Limits) {
+  const auto tree = make_tree();
+  counting_backend counting(tree);
+  glob::options opts;
+  opts.backend = &counting;
+  const auto all = sorted(glob::rglob("**/f*", opts));
+
+  const auto is_subset = [&](const std::vector<fs::path> &matches) {
+    const auto partial = sorted(matches);
+    return std::includes(all.begin(), all.end(), partial.begin(), partial.end());
+  };
+
+  glob::budget results;
+  results.max_results = 25;
+  auto result = glob::rglob_bounded("**/f*", results, opts);
+  EXPECT_EQ(result.status, glob::budget_status::results);
+  EXPECT_EQ(result.matches.size(), 25u);
+  EXPECT_TRUE(is_subset(result.matches));
+
+  // Exactly as many matches as allowed is a complete result
+  glob::budget exact;
+  exact.max_results = all.size();
+  result = glob::rglob_bounded("**/f*", exact, opts);
+  EXPECT_EQ(result.status, glob::budget_status::complete);
+  EXPECT_EQ(result.matches.size(), all.size());
+  exact.max_results = all.size() - 1;
+  result = glob::rglob_bounded("**/f*", exact, opts);
+  EXPECT_EQ(result.status, glob::budget_status::results);
+  EXPECT_EQ(result.matches.size(), all.size() - 1);
+
+  glob::budget directories;
+  directories.max_directories = 5;
+  counting.lists = 0;
+  result = glob::rglob_bounded("**/f*", directories, opts);
+  EXPECT_EQ(result.status, glob::budget_status::directories);
+  EXPECT_EQ(counting.lists, 5);
+  EXPECT_TRUE(is_subset(result.matches));
+  EXPECT_LT(result.matches.size(), all.size());
+
+  glob::budget entries;
+  entries.max_entries = 15;
+  result = glob::rglob_bounded("d0/**", entries, opts);
+  EXPECT_EQ(result.status, glob::budget_status::entries);
+  // "d0" itself and 15 of the entries below it
+  EXPECT_EQ(result.matches.size(), 16u);
+
+  glob::budget deadline;
+  deadline.deadline = std::chrono::steady_clock::now() - 1s;
+  counting.lists = 0;
+  result = glob::rglob_bounded("**/f*", deadline, opts);
+  EXPECT_EQ(result.status, glob::budget_status::deadline);
+  EXPECT_TRUE(result.matches.empty());
+  EXPECT_EQ(counting.lists, 0);
+}
+
+TEST(budgetTest, NoListingsAhead) {
+  const auto tree = make_tree();
+  counting_backend counting(tree);
+  glob::options opts;
+  opts.backend = &counting;
+  opts.io_concurrency = 8;
+
+  glob::budget limits;
+  limits.max_directories = 5;
+  const auto result = glob::rglob_bounded("**/f*", limits, opts);
+  EXPECT_EQ(result.status, glob::budget_status::directories);
+  // No listings are queued beyond the budget
+  EXPECT_EQ(counting.lists, 5);
+}
+
+TEST(budgetTest, Deadline) {
+  // A backend slow enough that the walk cannot finish in time
+  class slow_backend : public glob::backend {
+  public:
+    explicit slow_backend(const glob::backend &inner) : inner_(inner) {}
+
+    bool list(const fs::path &dirname, entry_list &entries) const override {
+      std::this_thread::sleep_for(2ms);
+      return inner_.list(dirname, entries);
+    }
+
+    fs::file_type type(const fs::path &path) const override { return inner_.type(path); }
+
+  private:
+    const glob::backend &inner_;
+  };
+
+  const auto tree = make_tree();
+  slow_backend slow(tree);
+  glob::options opts;
+  opts.backend = &slow;
+
+  glob::budget limits;
+  limits.deadline = std::chrono::steady_clock::now() + 20ms;
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = glob::rglob_bounded("**/f*", limits, opts);
+  EXPECT_EQ(result.status, glob::budget_status::deadline);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 200ms);
+  // Matches are found while "**" is still walking
+  EXPECT_FALSE(result.matches.empty());
+  EXPECT_LT(result.matches.size(), 1000u);
+}
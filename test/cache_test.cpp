@@ -0,0 +1,106 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+TEST(cacheTest, SeesNewEntries) {
+  auto temp_dir = mkdir_temp("cache_test");
+  fs::create_directory(temp_dir / "sub");
+  std::ofstream(temp_dir / "sub" / "a.txt").close();
+
+  glob::cache cache;
+  auto pattern = temp_dir.string() + "/**/*.txt";
+  EXPECT_EQ(glob::rglob(pattern, cache).size(), 1);
+
+  std::ofstream(temp_dir / "sub" / "b.txt").close();
+  std::ofstream(temp_dir / "c.txt").close();
+  auto matches = glob::rglob(pattern, cache);
+  EXPECT_EQ(matches.size(), 3);
+  EXPECT_EQ(matches, glob::rglob(pattern));
+
+  cache.clear();
+  EXPECT_EQ(glob::rglob(pattern, cache), matches);
+
+  fs::remove_all(temp_dir);
+}
+
+// On filesystems with coarse timestamps, an entry added right after a listing may leave the
+// directory's last write time unchanged
+TEST(cacheTest, SeesNewEntriesInTheSameTick) {
+  auto temp_dir = mkdir_temp("cache_test");
+  std::ofstream(temp_dir / "a.txt").close();
+  const auto stamp = fs::last_write_time(temp_dir);
+
+  glob::cache cache;
+  auto pattern = temp_dir.string() + "/*.txt";
+  EXPECT_EQ(glob::glob(pattern, cache).size(), 1);
+
+  std::ofstream(temp_dir / "b.txt").close();
+  fs::last_write_time(temp_dir, stamp);
+  EXPECT_EQ(glob::glob(pattern, cache).size(), 2);
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(cacheTest, ReusesSettledListings) {
+  auto temp_dir = mkdir_temp("cache_test");
+  std::ofstream(temp_dir / "a.txt").close();
+  const auto stamp = fs::file_time_type::clock::now() - std::chrono::hours(1);
+  fs::last_write_time(temp_dir, stamp);
+
+  glob::cache cache;
+  auto pattern = temp_dir.string() + "/*.txt";
+  EXPECT_EQ(glob::glob(pattern, cache).size(), 1);
+
+  // Hidden from the cache by restoring the old last write time
+  std::ofstream(temp_dir / "b.txt").close();
+  fs::last_write_time(temp_dir, stamp);
+  EXPECT_EQ(glob::glob(pattern, cache).size(), 1);
+  EXPECT_EQ(glob::glob(pattern).size(), 2);
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(cacheTest, DropsLeastRecentlyUsedListings) {
+  auto temp_dir = mkdir_temp("cache_test");
+  for (auto dir : {"a", "b", "c", "d"}) {
+    fs::create_directory(temp_dir / dir);
+    std::ofstream(temp_dir / dir / "x.txt").close();
+  }
+
+  glob::cache cache(2);
+  auto pattern = temp_dir.string() + "/**/*.txt";
+  const auto matches = glob::rglob(pattern, cache);
+  EXPECT_EQ(matches.size(), 4);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(glob::rglob(pattern, cache), matches);
+  EXPECT_EQ(cache.size(), 2);
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(cacheTest, RootsRelativePatternsAtBaseDir) {
+  auto temp_dir = mkdir_temp("cache_test");
+  fs::create_directory(temp_dir / "sub");
+  std::ofstream(temp_dir / "a.txt").close();
+  std::ofstream(temp_dir / "sub" / "b.txt").close();
+
+  glob::cache cache;
+  glob::options opts;
+  opts.base_dir = temp_dir;
+  EXPECT_EQ(sorted(glob::rglob("**", cache, opts)),
+            (std::vector<std::string>{"a.txt", "sub", "sub/b.txt"}));
+  EXPECT_GT(cache.size(), 0);
+  EXPECT_EQ(glob::glob("sub/*.txt", cache, opts), glob::glob("sub/*.txt", opts));
+
+  glob::memory_backend tree;
+  opts.backend = &tree;
+  EXPECT_THROW(glob::glob("*.txt", cache, opts), std::invalid_argument);
+
+  fs::remove_all(temp_dir);
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> filenames(std::vector<fs::path> paths) {
+  std::vector<std::string> result;
+  for (auto &path : paths) {
+    result.push_back(path.filename().string());
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+} // namespace
+
+TEST(caseInsensitiveTest, Wildcards) {
+  auto temp_dir = mkdir_temp("case_insensitive_test");
+  std::ofstream(temp_dir / "photo.JPG").close();
+  std::ofstream(temp_dir / "Image.jpg").close();
+  std::ofstream(temp_dir / "notes.txt").close();
+
+  glob::options opts;
+  opts.case_insensitive = true;
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/*.jpg", opts)),
+            (std::vector<std::string>{"Image.jpg", "photo.JPG"}));
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/[i]*", opts)),
+            (std::vector<std::string>{"Image.jpg"}));
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/[!i]*.JPG", opts)),
+            (std::vector<std::string>{"photo.JPG"}));
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/*.jpg")),
+            (std::vector<std::string>{"Image.jpg"}));
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(caseInsensitiveTest, LiteralComponents) {
+  auto temp_dir = mkdir_temp("case_insensitive_test");
+  fs::create_directory(temp_dir / "Src");
+  std::ofstream(temp_dir / "Src" / "Makefile").close();
+  std::ofstream(temp_dir / "Src" / "MAKEFILE").close();
+
+  glob::options opts;
+  opts.case_insensitive = true;
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/SRC/makefile", opts)),
+            (std::vector<std::string>{"MAKEFILE", "Makefile"}));
+  EXPECT_EQ(glob::glob(temp_dir.string() + "/src/*", opts).size(), 2);
+  EXPECT_TRUE(glob::glob(temp_dir.string() + "/src/makefile").empty());
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(caseInsensitiveTest, ProbesDirectoriesBeforeListing) {
+  auto temp_dir = mkdir_temp("case_insensitive_test");
+  fs::create_directory(temp_dir / "Src");
+  std::ofstream(temp_dir / "Src" / "main.CPP").close();
+
+  glob::disk_backend real;
+  counting_backend disk(real);
+  glob::options opts;
+  opts.case_insensitive = true;
+  opts.backend = &disk;
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/Src/*.cpp", opts)),
+            (std::vector<std::string>{"main.CPP"}));
+  EXPECT_EQ(disk.listings("/"), 0);
+  EXPECT_EQ(disk.listings(temp_dir.generic_string()), 0);
+  EXPECT_EQ(disk.listings((temp_dir / "Src").generic_string()), 1);
+
+  // No directory spelled "SRC": its parent is listed to find one
+  disk.reset();
+  EXPECT_EQ(filenames(glob::glob(temp_dir.string() + "/SRC/*.cpp", opts)),
+            (std::vector<std::string>{"main.CPP"}));
+  EXPECT_EQ(disk.listings("/"), 0);
+  EXPECT_EQ(disk.listings(temp_dir.generic_string()), 1);
+
+  fs::remove_all(temp_dir);
+}
+
+#ifndef _WIN32
+TEST(caseInsensitiveTest, ExecuteOnlyAncestors) {
+  if (geteuid() == 0) {
+    GTEST_SKIP() << "permissions do not apply to root";
+  }
+  auto temp_dir = mkdir_temp("case_insensitive_test");
+  fs::create_directories(temp_dir / "locked" / "Open");
+  std::ofstream(temp_dir / "locked" / "Open" / "a.TXT").close();
+  fs::permissions(temp_dir / "locked", fs::perms::owner_exec);
+
+  glob::options opts;
+  opts.case_insensitive = true;
+  const auto matches = filenames(glob::glob(temp_dir.string() + "/locked/Open/*.txt", opts));
+  fs::permissions(temp_dir / "locked", fs::perms::owner_all);
+  EXPECT_EQ(matches, (std::vector<std::string>{"a.TXT"}));
+
+  fs::remove_all(temp_dir);
+}
+#endif
+
+TEST(caseInsensitiveTest, UnicodeFolding) {
+  auto temp_dir = mkdir_temp("case_insensitive_test");
+  std::ofstream(temp_dir / "\xC3\x84pfel.txt").close();  // "Äpfel.txt"
+  std::ofstream(temp_dir / "\xD0\x9C\xD0\xB8\xD1\x80.txt").close();  // "Мир.txt"
+
+  glob::options opts;
+  opts.case_insensitive = true;
+  EXPECT_TRUE(glob::glob(temp_dir.string() + "/\xC3\xA4*", opts).empty());  // "ä*"
+
+  opts.unicode_case_folding = true;
+  EXPECT_EQ(glob::glob(temp_dir.string() + "/\xC3\xA4*", opts).size(), 1);
+  EXPECT_EQ(glob::glob(temp_dir.string() + "/\xD0\xBC\xD0\x98\xD0\xA0.TXT", opts).size(), 1);  // "мИР.TXT"
+
+  fs::remove_all(temp_dir);
+}
@@ -0,0 +1,113 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> strings(const std::vector<fs::path> &paths) {
+  std::vector<std::string> result;
+  for (auto &path : paths) {
+    result.push_back(path.string());
+  }
+  return result;
+}
+
+std::vector<std::string> strings(const glob::compact_paths &paths) {
+  return std::vector<std::string>(paths.begin(), paths.end());
+}
+
+} // namespace
+
+TEST(compactTest, RoundTrip) {
+  const std::vector<std::string> paths = {
+      "a",          "src/glob.cpp", "src/glob.h",  "src/glob.o", "include/glob/glob.h",
+      "src/main.c", "/",            "/usr",        "/usr/lib",   "dir/",
+      "dir//x",     "",             "src/glob.cpp"};
+  glob::compact_paths compact;
+  for (auto &path : paths) {
+    compact.push_back(path);
+  }
+  EXPECT_EQ(compact.size(), paths.size());
+  EXPECT_EQ(strings(compact), paths);
+  EXPECT_EQ(strings(compact.to_paths()), paths);
+
+  auto it = compact.begin();
+  std::advance(it, 2);
+  EXPECT_EQ(it.directory(), "src");
+  EXPECT_EQ(it.filename(), "glob.h");
+  EXPECT_EQ(it.path(), fs::path("src/glob.h"));
+
+  EXPECT_TRUE(glob::compact_paths{}.empty());
+  EXPECT_EQ(glob::compact_paths{}.begin(), glob::compact_paths{}.end());
+}
+
+TEST(compactTest, PushesDirectoryAndName) {
+  const std::vector<std::pair<std::string, std::string>> parts = {
+      {"src", "glob.cpp"}, {"src", "glob.h"}, {"/", "usr"}, {"dir/", "x"},
+      {"", "a"},           {"/usr", "lib"},   {"src", "a"}};
+  glob::compact_paths compact;
+  std::vector<std::string> expected;
+  for (auto &[dirname, name] : parts) {
+    compact.push_back(dirname, name);
+    expected.push_back((fs::path(dirname) / name).string());
+  }
+  EXPECT_EQ(strings(compact), expected);
+  EXPECT_EQ(compact.begin().directory(), "src");
+}
+
+TEST(compactTest, MatchesRglob) {
+  auto temp_dir = mkdir_temp("compact_test");
+  for (auto dir : {"a/b/c", "a/d", "e"}) {
+    fs::create_directories(temp_dir / dir);
+    for (auto name : {"x.txt", "y.txt", "z.md"}) {
+      std::ofstream(temp_dir / dir / name);
+    }
+  }
+
+  for (auto pattern : {"**/*.txt", "**", "*/*/*", "a/*/"}) {
+    const auto pathname = (temp_dir / pattern).string();
+    EXPECT_EQ(strings(glob::rglob_compact(pathname)), strings(glob::rglob(pathname))) << pattern;
+    EXPECT_EQ(strings(glob::glob_compact(pathname)), strings(glob::glob(pathname))) << pattern;
+  }
+  EXPECT_EQ(strings(glob::rglob_compact({(temp_dir / "a/**/*.md").string(), (temp_dir / "e/*").string()})),
+            strings(glob::rglob({(temp_dir / "a/**/*.md").string(), (temp_dir / "e/*").string()})));
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(compactTest, SharesDirectories) {
+  glob::memory_backend tree;
+  for (int d = 0; d < 10; ++d) {
+    for (int f = 0; f < 1000; ++f) {
+      tree.add_file("some/long/directory/name/" + std::to_string(d) + "/file_" + std::to_string(f) + ".txt");
+    }
+  }
+  glob::options opts;
+  opts.backend = &tree;
+
+  const auto compact = glob::rglob_compact("some/**/*.txt", opts);
+  ASSERT_EQ(compact.size(), 10000u);
+  EXPECT_EQ(strings(compact), strings(glob::rglob("some/**/*.txt", opts)));
+  // Each match costs a few bytes beyond its unique suffix rather than a path object apiece
+  EXPECT_LT(compact.memory_usage(), 10000 * sizeof(fs::path));
+}
+
+TEST(compactTest, RevisitsDirectories) {
+  // Enough directories to grow the directory table several times, each seen again later
+  std::vector<std::string> paths;
+  for (int round = 0; round < 3; ++round) {
+    for (int d = 0; d < 500; ++d) {
+      paths.push_back("dir_" + std::to_string(d * 7919 % 500) + "/file_" + std::to_string(round));
+    }
+  }
+  glob::compact_paths compact;
+  for (auto &path : paths) {
+    compact.push_back(path);
+  }
+  EXPECT_EQ(strings(compact), paths);
+}
@@ -0,0 +1,70 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+TEST(concurrencyTest, BaseDir) {
+  auto temp_dir = mkdir_temp("concurrency_test");
+  fs::create_directories(temp_dir / "a" / "b");
+  std::ofstream(temp_dir / "a" / "b" / "c.txt").close();
+
+  glob::options opts;
+  opts.base_dir = temp_dir;
+  EXPECT_EQ(sorted(glob::rglob("**/*.txt", opts)), (std::vector<std::string>{"a/b/c.txt"}));
+  EXPECT_EQ(sorted(glob::glob("a/*", opts)), (std::vector<std::string>{"a/b"}));
+  EXPECT_EQ(sorted(glob::glob("a/b/c.txt", opts)), (std::vector<std::string>{"a/b/c.txt"}));
+  EXPECT_EQ(sorted(glob::glob("*", opts)), (std::vector<std::string>{"a"}));
+  EXPECT_EQ(glob::glob((temp_dir / "a" / "*").string(), opts).size(), 1);
+
+  fs::remove_all(temp_dir);
+}
+
+// Many threads globbing under different roots at once; meant to be run under ThreadSanitizer
+// (-DUSE_SANITIZER=Thread) as well as normally.
+TEST(concurrencyTest, ParallelGlobsUnderDifferentRoots) {
+  auto temp_dir = mkdir_temp("concurrency_test");
+  constexpr int roots = 4;
+  for (int r = 0; r < roots; ++r) {
+    auto root = temp_dir / std::to_string(r);
+    fs::create_directories(root / "sub" / "deeper");
+    for (int f = 0; f <= r; ++f) {
+      std::ofstream(root / "sub" / ("file" + std::to_string(f) + ".txt")).close();
+      std::ofstream(root / "sub" / "deeper" / ("File" + std::to_string(f) + ".TXT")).close();
+    }
+  }
+
+  glob::cache cache;
+  std::atomic<int> failures{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 16; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 200; ++i) {
+        const int r = (t + i) % roots;
+        const auto expected = static_cast<std::size_t>(r + 1);
+
+        glob::options opts;
+        opts.base_dir = temp_dir / std::to_string(r);
+        opts.case_insensitive = i % 2 == 0;
+        const auto matches = glob::rglob("**/*.txt", opts);
+        if (matches.size() != (opts.case_insensitive ? 2 * expected : expected)) {
+          ++failures;
+        }
+        if (glob::glob((opts.base_dir / "sub" / "*.txt").string(), cache).size() != expected) {
+          ++failures;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(failures, 0);
+
+  fs::remove_all(temp_dir);
+}
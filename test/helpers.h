@@ -0,0 +1,100 @@
+#pragma once
+
+// Helpers shared by the test files
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef USE_SINGLE_HEADER
+#include "glob/glob.hpp"
+#else
+#include "glob/glob.h"
+#endif
+
+namespace fs = std::filesystem;
+
+/// Creates a new, empty directory named after `prefix` in the temporary directory. Names that
+/// already exist, e.g. left by another test or process, are skipped.
+inline fs::path mkdir_temp(const std::string &prefix) {
+  static std::atomic<unsigned> counter{0};
+  static const auto seed = std::random_device{}();
+  while (true) {
+    auto temp_dir = fs::temp_directory_path() /
+                    (prefix + "_" + std::to_string(seed) + "_" + std::to_string(counter++));
+    if (fs::create_directory(temp_dir)) {
+      return temp_dir;
+    }
+  }
+}
+
+/// `paths` as generic strings, sorted
+inline std::vector<std::string> sorted(const std::vector<fs::path> &paths) {
+  std::vector<std::string> result;
+  for (auto &path : paths) {
+    result.push_back(path.generic_string());
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+#ifndef USE_SINGLE_HEADER
+/// Counts calls into a wrapped backend, and listings per directory; safe for concurrent use like
+/// any backend must be
+class counting_backend : public glob::backend {
+public:
+  explicit counting_backend(const glob::backend &inner) : inner_(inner) {}
+
+  bool list(const fs::path &dirname, entry_list &entries) const override {
+    ++lists;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++listings_[dirname.generic_string()];
+    }
+    std::this_thread::sleep_for(delay);
+    return inner_.list(dirname, entries);
+  }
+
+  fs::file_type type(const fs::path &path) const override {
+    ++probes;
+    return inner_.type(path);
+  }
+
+  bool stat(const fs::path &path, glob::file_metadata &metadata) const override {
+    ++stats;
+    return inner_.stat(path, metadata);
+  }
+
+  /// Listings of `dirname` (in generic form)
+  int listings(const std::string &dirname) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = listings_.find(dirname);
+    return it == listings_.end() ? 0 : it->second;
+  }
+
+  void reset() {
+    lists = probes = stats = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    listings_.clear();
+  }
+
+  mutable std::atomic<int> lists{0};
+  mutable std::atomic<int> probes{0};
+  mutable std::atomic<int> stats{0};
+
+  /// Time each listing takes, e.g. long enough for workers listing ahead to catch up with a walk
+  std::chrono::milliseconds delay{0};
+
+private:
+  const glob::backend &inner_;
+  mutable std::mutex mutex_;
+  mutable std::map<std::string, int> listings_;
+};
+#endif
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <random>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <fnmatch.h>
+#endif
+
+#include "glob/glob.h"
+#include "helpers.h"
+#include "matcher.h"
+
+using glob::detail::match_engine;
+using glob::detail::match_name;
+
+namespace fs = std::filesystem;
+
+#ifndef _WIN32
+std::vector<std::string> posix_glob(const std::string &pattern);
+#endif
+
+namespace {
+
+// Random strings over `alphabet`, up to `max_length` long
+class corpus {
+public:
+  explicit corpus(unsigned seed) : rng_(seed) {}
+
+  std::string operator()(std::string_view alphabet, std::size_t max_length) {
+    std::string result(rng_() % (max_length + 1), ' ');
+    for (auto &c : result) {
+      c = alphabet[rng_() % alphabet.size()];
+    }
+    return result;
+  }
+
+private:
+  std::mt19937 rng_;
+};
+
+// Wildcard syntax and regex metacharacters, plus a UTF-8 sequence
+constexpr std::string_view PATTERN_ALPHABET = "abc.-*?[]!^\\(){}+|$&~# \xc3\xa9";
+constexpr std::string_view NAME_ALPHABET = "abcABC.-[]!^\\(){}+|$&~# \xc3\xa9";
+
+#ifndef _WIN32
+// Sets starting with '^' negate in fnmatch(3) and glob(3) but not here (nor in Python), and
+// POSIX bracket syntax ("[.", "[=", "[:") is not supported
+bool posix_only_syntax(std::string_view pattern) {
+  for (auto syntax : {"[^", "[!^", "[.", "[=", "[:"}) {
+    if (pattern.find(syntax) != std::string_view::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+} // namespace
+
+TEST(matcherTest, EnginesAgree) {
+  corpus random(42);
+  for (int i = 0; i < 20000; ++i) {
+    const auto pattern = random(PATTERN_ALPHABET, 8);
+    const auto name = random(NAME_ALPHABET, 8);
+    const bool native = match_name(name, pattern);
+    ASSERT_EQ(match_name(name, pattern, match_engine::regex), native)
+        << "pattern \"" << pattern << "\", name \"" << name << '"';
+#ifndef _WIN32
+    if (!posix_only_syntax(pattern)) {
+      ASSERT_EQ(::fnmatch(pattern.c_str(), name.c_str(), FNM_NOESCAPE) == 0, native)
+          << "pattern \"" << pattern << "\", name \"" << name << '"';
+    }
+#endif
+  }
+}
+
+#if !defined(_WIN32) && defined(FNM_CASEFOLD)
+TEST(matcherTest, CaseInsensitiveAgreesWithFnmatch) {
+  corpus random(7);
+  glob::options opts;
+  opts.case_insensitive = true;
+  for (int i = 0; i < 20000; ++i) {
+    const auto pattern = random("abcABC*?[]!-", 6);
+    const auto name = random("abcABC-", 6);
+    if (!posix_only_syntax(pattern)) {
+      ASSERT_EQ(::fnmatch(pattern.c_str(), name.c_str(), FNM_NOESCAPE | FNM_CASEFOLD) == 0,
+                match_name(name, pattern, match_engine::native, opts))
+          << "pattern \"" << pattern << "\", name \"" << name << '"';
+    }
+  }
+}
+#endif
+
+#ifndef _WIN32
+TEST(matcherTest, GlobAgreesWithPosixGlob) {
+  auto temp_dir = mkdir_temp("matcher_test");
+  corpus random(3);
+  for (int i = 0; i < 60; ++i) {
+    // glob(3) and glob::glob treat names starting with '.' differently, so there are none
+    const auto name = random("abc-[]!", 5);
+    if (!name.empty() && name[0] != '.') {
+      std::ofstream(temp_dir / name).close();
+    }
+  }
+
+  glob::options opts;
+  opts.base_dir = temp_dir;
+  for (int i = 0; i < 500; ++i) {
+    const auto pattern = random("abc-*?[]!", 5);
+    if (pattern.empty() || posix_only_syntax(pattern)) {
+      continue;
+    }
+    auto expected = posix_glob((temp_dir / pattern).string());
+    for (auto &path : expected) {
+      path = fs::path(path).lexically_relative(temp_dir).generic_string();
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(sorted(glob::glob(pattern, opts)), expected) << "pattern \"" << pattern << '"';
+  }
+
+  fs::remove_all(temp_dir);
+}
+#endif
+
+TEST(matcherTest, Pathological) {
+  // Backtracking only to the last star keeps these linear in the name length
+  const std::string name(20000, 'a');
+  EXPECT_FALSE(match_name(name, "*a*a*a*a*a*a*b"));
+  EXPECT_TRUE(match_name(name + "b", "*a*a*a*a*a*a*b"));
+  EXPECT_FALSE(match_name(name, "*?*?*?*?*[b]"));
+
+  const std::string short_name(64, 'a');
+#ifndef _WIN32
+  EXPECT_EQ(::fnmatch("*a*a*a*a*b", short_name.c_str(), 0) == 0, match_name(short_name, "*a*a*a*a*b"));
+#endif
+  EXPECT_FALSE(match_name(short_name, "*a*a*a*a*b", match_engine::regex));
+}
+
+TEST(matcherTest, Sets) {
+  // Cases the regex translation used to get wrong or reject
+  for (auto engine : {match_engine::native, match_engine::regex}) {
+    EXPECT_TRUE(match_name("]", "[]a]", engine));
+    EXPECT_FALSE(match_name("]", "[!]]", engine));
+    EXPECT_TRUE(match_name("c", "[!]]", engine));
+    EXPECT_TRUE(match_name("^", "[^a]", engine));
+    EXPECT_FALSE(match_name("\\", "[^a]", engine));
+    EXPECT_FALSE(match_name("b", "[z-a]", engine));
+    EXPECT_TRUE(match_name("-", "[--a]", engine));
+    EXPECT_FALSE(match_name("-", "[a--]", engine));
+    EXPECT_TRUE(match_name("[", "[[.]", engine));
+  }
+  EXPECT_NO_THROW(match_name("a", "[[.a]", match_engine::regex));
+  glob::options opts;
+  opts.case_insensitive = true;
+  EXPECT_THROW(match_name("a", "a", match_engine::regex, opts), std::invalid_argument);
+}
@@ -0,0 +1,107 @@
+#include <chrono>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+glob::memory_backend make_tree() {
+  glob::memory_backend tree;
+  for (auto dir : {"src/a", "src/b/deep", "src/c", "docs", ".hidden"}) {
+    for (auto name : {"x.h", "y.cpp", "z.h"}) {
+      tree.add_file(std::string(dir) + "/" + name);
+    }
+  }
+  tree.add_file("top.h");
+  return tree;
+}
+
+// Every page of `pathname` in `count`-sized pages, concatenated
+std::vector<fs::path> all_pages(const std::string &pathname, bool recursive, std::size_t count,
+                                const glob::options &opts) {
+  std::vector<fs::path> matches;
+  std::string token;
+  int pages = 0;
+  do {
+    auto page = recursive ? glob::rglob_page(pathname, count, token, opts)
+                          : glob::glob_page(pathname, count, token, opts);
+    EXPECT_LE(page.matches.size(), count);
+    matches.insert(matches.end(), page.matches.begin(), page.matches.end());
+    token = page.resume_token;
+  } while (!token.empty() && ++pages < 1000);
+  return matches;
+}
+
+} // namespace
+
+TEST(pageTest, PagesCoverTheResult) {
+  const auto tree = make_tree();
+  glob::options opts;
+  opts.backend = &tree;
+
+  for (auto pattern : {"**", "**/*.h", "src/**/", "*/*/*.h", "src/*", "**/deep/*", "*.h", "nothing/*"}) {
+    const auto expected = sorted(glob::rglob(pattern, opts));
+    const auto whole = all_pages(pattern, true, 1000, opts);
+    EXPECT_EQ(sorted(whole), expected) << pattern;
+    for (std::size_t count : {1, 2, 3, 7}) {
+      // The same stable order whatever the page size
+      EXPECT_EQ(all_pages(pattern, true, count, opts), whole) << pattern << " " << count;
+    }
+  }
+  for (auto pattern : {"*/*/*.h", "src/*/", "*"}) {
+    EXPECT_EQ(sorted(all_pages(pattern, false, 2, opts)), sorted(glob::glob(pattern, opts))) << pattern;
+  }
+}
+
+TEST(pageTest, ResumeSkipsEmittedDirectories) {
+  const auto tree = make_tree();
+  for (unsigned io_concurrency : {1, 8}) {
+    counting_backend counting(tree);
+    glob::options opts;
+    opts.backend = &counting;
+    opts.io_concurrency = io_concurrency;
+
+    auto first = glob::rglob_page("src/**/*.h", 4, {}, opts);
+    ASSERT_EQ(sorted(first.matches),
+              (std::vector<std::string>{"src/a/x.h", "src/a/z.h", "src/b/deep/x.h", "src/b/deep/z.h"}));
+    ASSERT_FALSE(first.resume_token.empty());
+
+    counting.reset();
+    counting.delay = std::chrono::milliseconds(5);
+    auto second = glob::rglob_page("src/**/*.h", 4, first.resume_token, opts);
+    EXPECT_EQ(sorted(second.matches), (std::vector<std::string>{"src/c/x.h", "src/c/z.h"}));
+    EXPECT_TRUE(second.resume_token.empty());
+    // Only the directories on the way to the resume position and after it are read again, not
+    // even ahead of the walk
+    EXPECT_EQ(counting.listings("src/a"), 0) << io_concurrency;
+    EXPECT_EQ(counting.listings("src/b"), 1) << io_concurrency;
+    if (io_concurrency == 1) {
+      // once by `**` and once for "*.h"
+      EXPECT_EQ(counting.listings("src/b/deep"), 2);
+      EXPECT_EQ(counting.listings("src/c"), 2);
+    }
+  }
+}
+
+TEST(pageTest, InvalidTokens) {
+  const auto tree = make_tree();
+  glob::options opts;
+  opts.backend = &tree;
+
+  const auto token = glob::rglob_page("**/*.h", 1, {}, opts).resume_token;
+  ASSERT_FALSE(token.empty());
+  EXPECT_THROW(glob::rglob_page("**/*.cpp", 1, token, opts), std::invalid_argument);
+  EXPECT_THROW(glob::glob_page("**/*.h", 1, token, opts), std::invalid_argument);
+  auto elsewhere = opts;
+  elsewhere.base_dir = "src";
+  EXPECT_THROW(glob::rglob_page("**/*.h", 1, token, elsewhere), std::invalid_argument);
+  EXPECT_THROW(glob::rglob_page("**/*.h", 1, token.substr(0, token.size() - 2), opts), std::invalid_argument);
+  EXPECT_THROW(glob::rglob_page("**/*.h", 1, token + "ff", opts), std::invalid_argument);
+  EXPECT_THROW(glob::rglob_page("**/*.h", 1, "not a token", opts), std::invalid_argument);
+  EXPECT_THROW(glob::rglob_page("**/*.h", 0, {}, opts), std::invalid_argument);
+}
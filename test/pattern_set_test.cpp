@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <set>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+TEST(patternSetTest, Match) {
+  glob::pattern_set set({"**/*.json", "logs/[0-9]?.txt"});
+  EXPECT_TRUE(set.match("a.json"));
+  EXPECT_TRUE(set.match("bucket/2024/01/a.json"));
+  EXPECT_TRUE(set.match("logs/07.txt"));
+  EXPECT_FALSE(set.match("logs/7.txt"));
+  EXPECT_FALSE(set.match("bucket/.cache/a.json"));
+  EXPECT_FALSE(set.match("bucket/a.jsonl"));
+
+  glob::pattern_set flat({"*/*.json"}, false);
+  EXPECT_TRUE(flat.match("a/b.json"));
+  EXPECT_FALSE(flat.match("a/b/c.json"));
+
+  glob::pattern_set dirs({"/srv/*/"});
+  EXPECT_TRUE(dirs.match("/srv/www/"));
+  EXPECT_FALSE(dirs.match("/srv/www"));
+  EXPECT_FALSE(dirs.match("srv/www/"));
+}
+
+TEST(patternSetTest, FilterIsOrderedAcrossThreads) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 100000; ++i) {
+    keys.push_back("objects/" + std::to_string(i % 97) + "/" + std::to_string(i) + (i % 3 ? ".bin" : ".json"));
+  }
+  glob::pattern_set set({"objects/**/*.json"});
+  auto single = set.filter(keys, 1);
+  EXPECT_EQ(single.size(), 33334);
+  EXPECT_TRUE(std::is_sorted(single.begin(), single.end()));
+  EXPECT_EQ(set.filter(keys, 8), single);
+}
+
+// Matching a listing of a tree in memory must agree with rglob on the same tree
+TEST(patternSetTest, AgreesWithRglob) {
+  auto temp_dir = mkdir_temp("pattern_set_test");
+  fs::create_directories(temp_dir / "a" / "b");
+  fs::create_directories(temp_dir / "d" / "c");
+  std::ofstream(temp_dir / "x.txt").close();
+  std::ofstream(temp_dir / "a" / "y.txt").close();
+  std::ofstream(temp_dir / "a" / "b" / "z.md").close();
+  std::ofstream(temp_dir / "d" / "c" / "w.txt").close();
+
+  std::vector<std::string> manifest;
+  for (auto &entry : fs::recursive_directory_iterator(temp_dir)) {
+    manifest.push_back(entry.path().string());
+  }
+
+  for (auto suffix : {"/**/*.txt", "/*/*", "/a/**", "/**/b", "/*.txt", "/d/*/*"}) {
+    const auto pattern = temp_dir.string() + suffix;
+    std::set<std::string> expected;
+    for (auto &match : glob::rglob(pattern)) {
+      auto path = match.string();
+      if (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+      }
+      expected.insert(path);
+    }
+    std::set<std::string> actual;
+    for (auto index : glob::pattern_set({pattern}).filter(manifest)) {
+      actual.insert(manifest[index]);
+    }
+    EXPECT_EQ(actual, expected) << pattern;
+  }
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(patternSetTest, SerializeRoundTrip) {
+  glob::options opts;
+  opts.case_insensitive = true;
+  const glob::pattern_set compiled({"**/*.[ch]pp", "/etc/[!.]*", "docs/"}, true, opts);
+  const auto blob = compiled.serialize();
+
+  const std::vector<std::string> paths{"src/A.HPP", "src/a.cpp", "src/a.py", "/etc/hosts",
+                                       "/etc/.hidden", "docs/", "docs"};
+  const auto expected = compiled.filter(paths, 1);
+  EXPECT_EQ(expected, (std::vector<std::size_t>{0, 1, 3, 5}));
+
+  const auto view = glob::pattern_set::deserialize(blob.data(), blob.size());
+  EXPECT_EQ(view.filter(paths, 1), expected);
+  EXPECT_EQ(view.serialize(), blob);
+
+  auto temp_dir = mkdir_temp("pattern_set_test");
+  auto file = temp_dir / "patterns.bin";
+  std::ofstream(file, std::ios::binary).write(reinterpret_cast<const char *>(blob.data()), blob.size());
+  const auto mapped = glob::pattern_set::map_file(file);
+  EXPECT_EQ(mapped.filter(paths, 1), expected);
+  fs::remove_all(temp_dir);
+}
+
+TEST(patternSetTest, RejectsBadBlobs) {
+  const auto blob = glob::pattern_set({"*.txt"}).serialize();
+
+  auto truncated = blob;
+  truncated.pop_back();
+  EXPECT_THROW(glob::pattern_set::deserialize(truncated.data(), truncated.size()), std::invalid_argument);
+
+  auto wrong_version = blob;
+  wrong_version[12] ^= 0xFF;
+  EXPECT_THROW(glob::pattern_set::deserialize(wrong_version.data(), wrong_version.size()),
+               std::invalid_argument);
+
+  auto wrong_magic = blob;
+  wrong_magic[0] = 'X';
+  EXPECT_THROW(glob::pattern_set::deserialize(wrong_magic.data(), wrong_magic.size()), std::invalid_argument);
+
+  EXPECT_THROW(glob::pattern_set::map_file(fs::temp_directory_path() / "does-not-exist.bin"),
+               std::system_error);
+}
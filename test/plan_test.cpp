@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using kind = glob::plan::step_kind;
+using io = glob::plan::io_kind;
+
+} // namespace
+
+TEST(planTest, Steps) {
+  auto plan = glob::explain("src/*/include/glob/*.h");
+  EXPECT_EQ(plan.start, fs::path("src"));
+  ASSERT_EQ(plan.steps.size(), 3u);
+  EXPECT_EQ(plan.steps[0].kind, kind::wildcard);
+  EXPECT_EQ(plan.steps[0].io, io::list);
+  EXPECT_EQ(plan.steps[1].kind, kind::literal);
+  EXPECT_EQ(fs::path(plan.steps[1].segment), fs::path("include/glob"));
+  EXPECT_EQ(plan.steps[1].io, io::probe);
+  EXPECT_EQ(plan.steps[2].segment, "*.h");
+
+  plan = glob::explain("**/*/", true);
+  ASSERT_EQ(plan.steps.size(), 3u);
+  EXPECT_EQ(plan.steps[0].kind, kind::recursive);
+  EXPECT_EQ(plan.steps[0].io, io::walk);
+  EXPECT_EQ(plan.steps[2].kind, kind::dironly);
+  EXPECT_EQ(plan.steps[2].io, io::none);
+
+  // Without rglob, "**" is an ordinary wildcard
+  EXPECT_EQ(glob::explain("**/*").steps[0].kind, kind::wildcard);
+
+  // A literal pattern is a single probe
+  plan = glob::explain("include/glob/glob.h");
+  ASSERT_EQ(plan.steps.size(), 1u);
+  EXPECT_EQ(plan.steps[0].io, io::probe);
+
+  // Dot components are resolved lexically, so they are not merged into a probe
+  EXPECT_EQ(glob::explain("*/a/../b").steps.size(), 4u);
+
+  // With case folding literal components are listed
+  glob::options opts;
+  opts.case_insensitive = true;
+  plan = glob::explain("Src/*.h", false, opts);
+  EXPECT_TRUE(plan.start.empty());
+  ASSERT_EQ(plan.steps.size(), 2u);
+  EXPECT_EQ(plan.steps[0].kind, kind::literal);
+  EXPECT_EQ(plan.steps[0].io, io::list);
+
+  EXPECT_EQ(glob::explain("src/*/include/glob/*.h").str(),
+            "start: \"src\"\n"
+            "1. wildcard \"*\": 1 listing\n"
+            "2. literal \"include/glob\": 1 probe per path from step 1\n"
+            "3. wildcard \"*.h\": 1 listing per path from step 2\n");
+}
+
+TEST(planTest, LiteralRunsAreProbedOnce) {
+  glob::memory_backend tree;
+  tree.add_file("src/a/include/glob/glob.h");
+  tree.add_file("src/b/include/glob/util.h");
+  tree.add_file("src/c/include/other.h");
+  tree.add_file("src/d.h");
+  const counting_backend counting(tree);
+  glob::options opts;
+  opts.backend = &counting;
+
+  EXPECT_EQ(sorted(glob::glob("src/*/include/glob/*.h", opts)),
+            (std::vector<std::string>{"src/a/include/glob/glob.h", "src/b/include/glob/util.h"}));
+  // "src" once, then one probe per subdirectory and one listing per "include/glob" found
+  EXPECT_EQ(counting.lists, 3);
+  EXPECT_EQ(counting.probes, 3);
+
+  counting.lists = counting.probes = 0;
+  EXPECT_EQ(sorted(glob::glob("src/*/include/", opts)),
+            (std::vector<std::string>{"src/a/include/", "src/b/include/", "src/c/include/"}));
+  EXPECT_EQ(counting.lists, 1);
+  EXPECT_EQ(counting.probes, 3);
+}
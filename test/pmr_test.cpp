@@ -0,0 +1,120 @@
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <new>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+// GCC sees the malloc behind the replaced operator new below and the free behind the replaced
+// operator delete, and takes them for a mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+// Allocations from the global heap, counted by the replacements of operator new below
+std::atomic<std::size_t> global_allocations{0};
+
+} // namespace
+
+void *operator new(std::size_t bytes) {
+  ++global_allocations;
+  if (auto *p = std::malloc(bytes == 0 ? 1 : bytes)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// std::pmr::new_delete_resource allocates through the aligned forms
+void *operator new(std::size_t bytes, std::align_val_t alignment) {
+  ++global_allocations;
+  const auto align = static_cast<std::size_t>(alignment);
+  if (auto *p = std::aligned_alloc(align, (bytes + align - 1) / align * align + (bytes == 0 ? align : 0))) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+// Counts allocations forwarded to the upstream resource
+class counting_resource : public std::pmr::memory_resource {
+public:
+  std::size_t allocations = 0;
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+} // namespace
+
+TEST(pmrTest, MatchesDefaultOverload) {
+  auto temp_dir = mkdir_temp("pmr_test");
+  fs::create_directory(temp_dir / "sub");
+  std::ofstream(temp_dir / "a.txt").close();
+  std::ofstream(temp_dir / "sub" / "b.txt").close();
+  std::ofstream(temp_dir / "sub" / "c.md").close();
+
+  counting_resource upstream;
+  std::pmr::monotonic_buffer_resource arena(&upstream);
+  auto pattern = temp_dir.string() + "/**/*.txt";
+  auto matches = glob::rglob(pattern, &arena);
+
+  EXPECT_EQ(matches.get_allocator().resource(), &arena);
+  EXPECT_GT(upstream.allocations, 0);
+  EXPECT_EQ(std::vector<fs::path>(matches.begin(), matches.end()), glob::rglob(pattern));
+
+  fs::remove_all(temp_dir);
+}
+
+TEST(pmrTest, ListsStayOffGlobalHeap) {
+  auto temp_dir = mkdir_temp("pmr_test");
+  for (auto dir : {"a", "b", "c"}) {
+    fs::create_directory(temp_dir / dir);
+    for (int i = 0; i < 32; ++i) {
+      std::ofstream(temp_dir / dir / ("f" + std::to_string(i) + ".txt")).close();
+    }
+  }
+  // Nothing matches, so whatever is allocated is listings and intermediate lists
+  const auto pattern = temp_dir.string() + "/**/*.md";
+
+  auto before = global_allocations.load();
+  EXPECT_TRUE(glob::rglob(pattern).empty());
+  const auto without_arena = global_allocations.load() - before;
+
+  static std::array<std::byte, 1 << 20> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+  before = global_allocations.load();
+  EXPECT_TRUE(glob::rglob(pattern, &arena).empty());
+  const auto with_arena = global_allocations.load() - before;
+
+  // Each of the four listings grows its entries a few times on the global heap without the arena
+  EXPECT_LT(with_arena + 4 * 4, without_arena);
+
+  fs::remove_all(temp_dir);
+}
@@ -0,0 +1,19 @@
+// glob(3) for the differential tests in matcher_test.cpp. It lives in a translation unit of its
+// own because <glob.h> declares a function `glob`, which cannot coexist with namespace glob.
+#ifndef _WIN32
+#include <glob.h>
+#include <string>
+#include <vector>
+
+std::vector<std::string> posix_glob(const std::string &pattern) {
+  std::vector<std::string> paths;
+  glob_t result{};
+  if (::glob(pattern.c_str(), GLOB_NOESCAPE, nullptr, &result) == 0) {
+    for (std::size_t i = 0; i < result.gl_pathc; ++i) {
+      paths.push_back(result.gl_pathv[i]);
+    }
+  }
+  ::globfree(&result);
+  return paths;
+}
+#endif
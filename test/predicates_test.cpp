@@ -0,0 +1,72 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "glob/glob.h"
+#include "helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::chrono_literals;
+
+} // namespace
+
+TEST(predicatesTest, MemoryTree) {
+  const auto now = std::chrono::system_clock::now();
+  glob::memory_backend tree;
+  tree.add_file("logs/old.log", 4 << 20, now - 48h);
+  tree.add_file("logs/big.log", 2 << 20, now - 10min);
+  tree.add_file("logs/small.log", 100, now - 5min);
+  tree.add_directory("logs/archive.log");
+  const counting_backend counting(tree);
+
+  glob::options opts;
+  opts.backend = &counting;
+  opts.predicates.type = fs::file_type::regular;
+  EXPECT_EQ(sorted(glob::glob("logs/*.log", opts)),
+            (std::vector<std::string>{"logs/big.log", "logs/old.log", "logs/small.log"}));
+  // The listing knows the types
+  EXPECT_EQ(counting.stats, 0);
+
+  opts.predicates.min_size = 1 << 20;
+  opts.predicates.min_mtime = now - 1h;
+  EXPECT_EQ(sorted(glob::rglob("**/*.log", opts)), (std::vector<std::string>{"logs/big.log"}));
+  EXPECT_EQ(counting.stats, 4);
+
+  opts.predicates = {};
+  opts.predicates.predicate = [](const fs::path &path, const glob::file_metadata &metadata) {
+    return metadata.size < 1000 || path.stem() == "archive";
+  };
+  EXPECT_EQ(sorted(glob::glob("logs/*", opts)), (std::vector<std::string>{"logs/archive.log", "logs/small.log"}));
+
+  // Only results are filtered: directories on the way are still descended into
+  opts.predicates = {};
+  opts.predicates.type = fs::file_type::directory;
+  EXPECT_EQ(sorted(glob::rglob("**", opts)), (std::vector<std::string>{"logs", "logs/archive.log"}));
+  EXPECT_TRUE(glob::glob("logs/small.log", opts).empty());
+}
+
+TEST(predicatesTest, Disk) {
+  auto temp_dir = mkdir_temp("predicates_test");
+  fs::create_directories(temp_dir / "data" / "empty.bin");
+  std::ofstream(temp_dir / "data" / "zero.bin").close();
+  std::ofstream(temp_dir / "data" / "full.bin") << std::string(4096, 'x');
+
+  glob::options opts;
+  opts.base_dir = temp_dir;
+  opts.predicates.type = fs::file_type::regular;
+  EXPECT_EQ(sorted(glob::glob("data/*.bin", opts)), (std::vector<std::string>{"data/full.bin", "data/zero.bin"}));
+
+  opts.predicates.min_size = 1;
+  opts.predicates.min_mtime = std::chrono::system_clock::now() - 1h;
+  EXPECT_EQ(sorted(glob::rglob("**/*.bin", opts)), (std::vector<std::string>{"data/full.bin"}));
+  EXPECT_EQ(sorted(glob::glob("data/full.bin", opts)), (std::vector<std::string>{"data/full.bin"}));
+
+  opts.predicates.max_ctime = std::chrono::system_clock::now() - 1h;
+  EXPECT_TRUE(glob::glob("data/*.bin", opts).empty());
+
+  fs::remove_all(temp_dir);
+}
@@ -1,24 +1,12 @@
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
-#include <stdlib.h>
 
-#ifdef USE_SINGLE_HEADER
-#include "glob/glob.hpp"
-#else
-#include "glob/glob.h"
-#endif
+#include "helpers.h"
 
 namespace fs = std::filesystem;
 
-fs::path mkdir_temp() {
-  std::srand(std::time(nullptr));
-  fs::path temp_dir = fs::temp_directory_path() / ("rglob_test_" + std::to_string(std::rand()));
-
-  fs::create_directories(temp_dir);
-  return temp_dir;
-}
-
 // regression test to avoid matching an non existing file
 TEST(rglobTest, MatchNonExistent) {
   auto matches = glob::rglob("non-existent/**");
@@ -27,7 +15,7 @@ TEST(rglobTest, MatchNonExistent) {
 
 // see https://github.com/p-ranav/glob/issues/3
 TEST(rglobTest, Issue3) {
-  auto temp_dir = mkdir_temp();
+  auto temp_dir = mkdir_temp("rglob_test");
   std::cout << "Temporary directory: " << temp_dir << std::endl;
 
   fs::path sub1 = temp_dir / "sub";
@@ -48,3 +36,59 @@ TEST(rglobTest, Issue3) {
   EXPECT_EQ(matches[1].string(), (sub1 / "file.txt").string());
   EXPECT_EQ(matches[2].string(), (sub2 / "file.txt").string());
 }
+
+// Bracket sets keep their shell meaning once translated to a regex
+TEST(rglobTest, BracketSets) {
+  auto temp_dir = mkdir_temp("rglob_test");
+  for (auto name : {"]", "[", "^", "-", "a", "c"}) {
+    std::ofstream(temp_dir / name).close();
+  }
+  const auto names = [&](const std::string &pattern) {
+    std::vector<std::string> result;
+    for (auto &path : glob::glob((temp_dir / pattern).string())) {
+      result.push_back(path.filename().string());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+
+  EXPECT_EQ(names("[]a]"), (std::vector<std::string>{"]", "a"}));
+  EXPECT_EQ(names("[!]]"), (std::vector<std::string>{"-", "[", "^", "a", "c"}));
+  EXPECT_EQ(names("[^c]"), (std::vector<std::string>{"^", "c"}));
+  EXPECT_EQ(names("[[.]"), (std::vector<std::string>{"["}));
+  EXPECT_EQ(names("[--.]"), (std::vector<std::string>{"-"}));
+  EXPECT_TRUE(names("[c-a]").empty());
+  EXPECT_TRUE(names("[a--]").empty());
+
+  fs::remove_all(temp_dir);
+}
+
+#ifndef USE_SINGLE_HEADER
+// Wildcards skip a name when the path reported for it starts with '.': names directly in the
+// starting directory, never names below an absolute or a nested relative directory
+TEST(rglobTest, HiddenNames) {
+  auto temp_dir = mkdir_temp("rglob_test");
+  fs::create_directories(temp_dir / "sub");
+  std::ofstream(temp_dir / ".dot.txt").close();
+  std::ofstream(temp_dir / "a.txt").close();
+  std::ofstream(temp_dir / "sub" / ".dot.txt").close();
+
+  const auto names = [](const std::vector<fs::path> &paths) {
+    std::vector<std::string> result;
+    for (auto &path : paths) {
+      result.push_back(path.filename().string());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  EXPECT_EQ(names(glob::glob((temp_dir / "*.txt").string())), (std::vector<std::string>{".dot.txt", "a.txt"}));
+
+  glob::options opts;
+  opts.base_dir = temp_dir;
+  EXPECT_EQ(sorted(glob::glob("*.txt", opts)), (std::vector<std::string>{"a.txt"}));
+  EXPECT_EQ(sorted(glob::glob("sub/*.txt", opts)), (std::vector<std::string>{"sub/.dot.txt"}));
+  EXPECT_EQ(sorted(glob::rglob("**", opts)), (std::vector<std::string>{"a.txt", "sub", "sub/.dot.txt"}));
+
+  fs::remove_all(temp_dir);
+}
+#endif